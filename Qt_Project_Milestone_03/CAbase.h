@@ -1,28 +1,136 @@
 #ifndef CABASE_H
 #define CABASE_H
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <ctime>
 #include <qmath.h>
 #include <QtDebug>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "CAgrid.h"
+#include "tracerecorder.h"
+
+struct CAexpiry {
+    /* predator-prey lifetimes are stored as the generation in which they run out
+     *
+     * A cell that stays or moves keeps its stamp, so a step only writes the cells whose
+     * occupant moves, is born or dies. The countdown of the rules (and of saved games) is
+     * the stamp minus the current generation; stamps are compared by their difference to
+     * the generation, which stays correct when the generation counter wraps around.
+     */
+
+    static const int never = INT_MAX;       // empty cells, food and cells without a limit
+    static const int unlimited = 0x7fff;    // the countdown of such cells, CAbase::maxLifetime
+
+    static int stamp(int lifetime, unsigned int generation) {
+        return (lifetime == unlimited) ? never : int(generation + unsigned(lifetime));
+    }
+
+    static int lifetime(int expiry, unsigned int generation) {
+        return (expiry == never) ? unlimited : int(unsigned(expiry) - generation);
+    }
+};
+
+
+struct CAview {
+    /* read-only view of the state of a CAbase, valid until the board is stepped, cleared or resized */
+
+    const int *world;    // stride nx + 2, see CAbase::getValue
+    const int *lifetime; // same layout, expiry generations (see CAexpiry)
+    int nx;
+    int ny;
+    int directionPast;
+    int directionFuture;
+    int headX;
+    int headY;
+    int foodX;
+    int foodY;
+    int snakeLength;
+    int snakeAction;
+    unsigned int generation;
+    bool nochanges;
+
+    int getValue(int x, int y) const {
+        return world[y * (nx + 2) + x];
+    }
+
+    int getLifetime(int x, int y) const {
+        return CAexpiry::lifetime(lifetime[y * (nx + 2) + x], generation);
+    }
+};
+
+
+class CAsnapshot {
+    /* copy of the state of a CAbase that outlives steps, copies of a snapshot share its data */
+
+public:
+    bool isNull() const {
+        return !data;
+    }
+
+    const CAview &view() const {
+        return data->view;
+    }
+
+private:
+    friend class CAbase;
+
+    struct planes {
+        std::vector<int> world;
+        std::vector<int> lifetime;
+        CAview view; // points into world and lifetime
+    };
+
+    std::shared_ptr<const planes> data;
+};
+
 
 class CAbase {
+    friend class CAhistory;
 
 public:
     CAbase() :
+        lifeTimeUI(0),
         Ny(10),
         Nx(10),
-        nochanges(false)
-        { resetWorldSize(Nx, Ny, 1); }
+        nochanges(false),
+        snakeAction(0),
+        snakeLength(0),
+        randomSeed(0),
+        generation(0),
+        randomState(0),
+        capacity(0),
+        rowCapacity(0),
+        agentsValid(false)
+        { resetWorldSize(Nx, Ny); }
 
     CAbase(int nx, int ny) :
+        lifeTimeUI(0),
         Ny(ny),
         Nx(nx),
-        nochanges(false)
-        { resetWorldSize(Nx, Ny, 1); }
-
-    ~CAbase() {
-    }
+        nochanges(false),
+        snakeAction(0),
+        snakeLength(0),
+        randomSeed(0),
+        generation(0),
+        randomState(0),
+        capacity(0),
+        rowCapacity(0),
+        agentsValid(false)
+        { resetWorldSize(Nx, Ny); }
+
+    // the buffers are owned by the instance: moving is cheap, copies are explicit (see clone);
+    // a moved-from board has no buffers and is usable again after resetWorldSize
+    CAbase(const CAbase &) = delete;
+    CAbase &operator=(const CAbase &) = delete;
+    CAbase(CAbase &&) = default;
+    CAbase &operator=(CAbase &&) = default;
+
+    CAbase clone() const;
 
     int getNy() {
         return Ny;
@@ -48,18 +156,28 @@ public:
     }
 
     int getLifetime(int x, int y) {
-        // get lifetime of cell x, y
-        return worldLifetime[y * (Nx + 2) + x];
+        // get lifetime of cell x, y (generations left, maxLifetime for no limit)
+        return CAexpiry::lifetime(worldLifetime[y * (Nx + 2) + x], generation);
     }
 
     void setLifetime(int x, int y, int l) {
         // set lifetime l into cell with coordinates x,y in current lifetime universe
-        worldLifetime[y * (Nx + 2) + x] = l;
+        worldLifetime[y * (Nx + 2) + x] = CAexpiry::stamp(l, generation);
+        agentsValid = false;
     }
 
     void setLifetimeNew(int x, int y, int l) {
-        // set new lifetime l for x,y
-        worldLifetimeNew[y * (Nx + 2) + x] = l;
+        // set new lifetime l for x,y, counted from the next generation
+        worldLifetimeNew[y * (Nx + 2) + x] = CAexpiry::stamp(l, generation + 1);
+    }
+
+    int getExpiry(int x, int y) {
+        // generation in which the lifetime of x, y runs out (see CAexpiry)
+        return worldLifetime[y * (Nx + 2) + x];
+    }
+
+    void setExpiryNew(int x, int y, int e) {
+        worldLifetimeNew[y * (Nx + 2) + x] = e;
     }
 
     int getValue(int x, int y) {
@@ -69,6 +187,7 @@ public:
     void setValue(int x, int y, int i) {
         // set number i into cell with coordinates x,y in current universe
         world[y * (Nx + 2) + x] = i;
+        agentsValid = false;
     }
 
     void setValueNew(int x, int y, int i) {
@@ -77,24 +196,77 @@ public:
     }
 
     int getDirection(int x, int y) {
-        return worldDirection[y * (Nx + 2) + x];
+        // directions only live in a rolling window of rows (see worldEvolutionPredator)
+        return worldDirection[(y & (directionRows - 1)) * (Nx + 2) + x];
     }
 
     void setDirection(int x, int y, int i) {
-        worldDirection[y * (Nx + 2) + x] = i;
+        worldDirection[(y & (directionRows - 1)) * (Nx + 2) + x] = i;
+    }
+
+    int getWinner(int x, int y) {
+        // index of the neighbor moving into x, y (see cellEvolutionConsistency), same rolling window
+        return worldWinner[(y & (directionRows - 1)) * (Nx + 2) + x];
+    }
+
+    void setWinner(int x, int y, int i) {
+        worldWinner[(y & (directionRows - 1)) * (Nx + 2) + x] = i;
+    }
+
+    void setSeed(unsigned int s) {
+        // seed of the per-cell random numbers and the board's random stream (reset to the current time by resetWorldSize)
+        randomSeed = s;
+        randomState = s;
+    }
+
+    const int *getWorld() const {
+        // read-only access to the current universe, stride getNx() + 2 (see getValue)
+        return world.get();
+    }
+
+    void setRow(int y, const int *cells) {
+        // copy Nx cells into row y of the current universe, rows 0 and Ny + 1 are the halo rows
+        memcpy(world.get() + y * (Nx + 2) + 1, cells, Nx * sizeof(int));
+        agentsValid = false;
+    }
+
+    CAview view() const;
+
+    CAsnapshot snapshot() const;
+
+    unsigned int getGeneration() const {
+        return generation;
     }
 
+    unsigned int cellRandom(int x, int y, int phase);
+
+    unsigned int nextRandom();
+
     bool isNotChanged() {
         return nochanges;
     }
 
-    void resetWorldSize(int nx, int ny, bool del = 0);
+    qint64 getBufferBytes() const {
+        // bytes allocated for the planes, the direction windows and the predator-prey agents
+        return (6 * qint64(capacity) + 2 * qint64(directionRows) * rowCapacity) * qint64(sizeof(int)) + capacity +
+               qint64(agents.capacity() + agentCells.capacity() + agentMoves.capacity()) * qint64(sizeof(int));
+    }
+
+    void resetWorldSize(int nx, int ny);
+
+    void clearWorld();
 
     // GAME OF LIFE
     int cellEvolutionLife(int x, int y);
 
     void worldEvolutionLife();
 
+    void worldEvolutionLifeStrip();
+
+    void putRandomSoup(int x0, int y0, int w, int h, double density);
+
+    int countLife();
+
     // SNAKE
     struct direction {
         int past;
@@ -124,6 +296,8 @@ public:
         snakeAction = a;
     }
 
+    void turnSnake(int dS);
+
     void calcSnakeAction();
 
     void worldEvolutionSnake();
@@ -133,7 +307,9 @@ public:
     void putInitSnake();
 
     // PREDATOR
-    const int maxLifetime = __INT16_MAX__;
+    static const int maxLifetime = CAexpiry::unlimited;
+
+    static const int directionRows = 8;
 
     int lifeTimeUI;
 
@@ -143,90 +319,261 @@ public:
 
     void cellEvolutionDirection(int x, int y);
 
+    int cellDirection(int x, int y);
+
     void worldEvolutionPredator();
 
+    int getAgentCount() const {
+        // predators, prey and other cells with a limited lifetime, once a predator-prey step has listed them
+        return agentsValid ? int(agents.size()) : -1;
+    }
+
+    void putRandomPredator(double density, int lifetime);
+
+    void countPredator(int &predators, int &prey, int &food);
+
 
 private:
+    // board of nx x ny cells whose buffers are allocated but not cleared (see clone)
+    struct uninitialized {};
+    CAbase(int nx, int ny, uninitialized) :
+        lifeTimeUI(0),
+        Ny(ny),
+        Nx(nx),
+        nochanges(false),
+        snakeAction(0),
+        snakeLength(0),
+        randomSeed(0),
+        generation(0),
+        randomState(0),
+        capacity(0),
+        rowCapacity(0),
+        agentsValid(false)
+        { allocateWorld(); }
+
+    void allocateWorld();
+
     int Ny;
     int Nx;
-    int *world;
-    int *worldNew;
-    int *worldColor;
-    int *worldColorNew;
-    int *worldLifetime;
-    int *worldLifetimeNew;
-    int *worldDirection;
+    std::unique_ptr<int[]> world;
+    std::unique_ptr<int[]> worldNew;
+    std::unique_ptr<int[]> worldColor;
+    std::unique_ptr<int[]> worldColorNew;
+    std::unique_ptr<int[]> worldLifetime;
+    std::unique_ptr<int[]> worldLifetimeNew;
+    std::unique_ptr<int[]> worldDirection;
+    std::unique_ptr<int[]> worldWinner;
     bool nochanges;
     int snakeAction;
     int snakeLength;
+    unsigned int randomSeed;
+    unsigned int generation;
+    uint64_t randomState;
+    int capacity;    // cells allocated for each universe plane
+    int rowCapacity; // cells allocated for each row of the direction and winner windows
+
+    // predator-prey: the cells that change on their own (agents), valid until the board is written elsewhere
+    std::vector<int> agents;
+    bool agentsValid;
+    std::unique_ptr<unsigned char[]> worldMarks; // claims and winners of the cells an agent step touches, 0 elsewhere
+    std::vector<int> agentCells;                 // the agents and the cells they move into
+    std::vector<int> agentMoves;                 // direction of each agent, then new value and expiry of each cell
+
+    void clearPlane(int *plane, int interior);
+
+    void cellNextState(int value, int expiry, bool movesAway, bool hasIncoming,
+                       int incomingValue, int incomingExpiry, int &newValue, int &newExpiry);
+
+    void worldEvolutionPredatorDense();
+
+    // the direction rules of predators and prey as tables (see cellDirection)
+    struct predatorTable {
+        static const int neighborhoods = 5 * 5 * 5 * 5 * 5; // state classes of the cell and its four neighbors
+        unsigned char mask[neighborhoods];   // candidate directions, bit i - 1 for neighbor i
+        unsigned char count[16];             // candidates per mask
+        unsigned char direction[16][4];      // direction of the k-th candidate
+    };
+
+    static int candidateDirections(const int neighbors[5]);
+
+    static const predatorTable &predatorRules();
+
+    static int stateClass(int value) {
+        // 0 empty (and any other state), 1 predator, 2 prey, 3 food, 4 boundary
+        static const unsigned char classes[7] = {4, 0, 1, 2, 0, 0, 3}; // values -1 to 5
+        return (unsigned(value + 1) < 7) ? classes[value + 1] : 0;
+    }
+
+    void worldEvolutionPredatorAgents();
 };
 
 
-inline void CAbase::resetWorldSize(int nx, int ny, bool del) {
+inline void CAbase::resetWorldSize(int nx, int ny) {
     /* main function to reset the cellular automata */
 
     // initialize randomization
     srand(time(NULL));
+    randomSeed = (unsigned int) time(NULL);
+    randomState = randomSeed;
+    generation = 0;
 
-    // creation or re-creation of current and new universe with default values (0 for non-border cell and -1 for border cell)
     Nx = nx;
     Ny = ny;
+    allocateWorld();
+    clearWorld();
+}
+
+
+inline void CAbase::allocateWorld() {
+    /* buffers for Nx x Ny cells, contents undefined
+     *
+     * The buffers are only re-created when the universe grows, smaller universes reuse
+     * them (a moved-from board keeps its capacities but has lost the buffers).
+     */
+
+    int cells = (Ny + 2) * (Nx + 2) + 1;
+
+    if (cells > capacity || !world) {
+        world.reset(new int[cells]);
+        worldNew.reset(new int[cells]);
+
+        worldColor.reset(new int[cells]);
+        worldColorNew.reset(new int[cells]);
+
+        worldLifetime.reset(new int[cells]);
+        worldLifetimeNew.reset(new int[cells]);
+
+        worldMarks.reset(new unsigned char[cells]);
+
+        capacity = cells;
+    }
 
-    if (!del) {
-        delete[] world;
-        delete[] worldNew;
+    if (Nx + 2 > rowCapacity || !worldDirection) {
+        worldDirection.reset(new int[directionRows * (Nx + 2)]);
+        worldWinner.reset(new int[directionRows * (Nx + 2)]);
+
+        rowCapacity = Nx + 2;
+    }
+}
 
-        delete[] worldColor;
-        delete[] worldColorNew;
 
-        delete[] worldLifetime;
-        delete[] worldLifetimeNew;
+inline void CAbase::clearPlane(int *plane, int interior) {
+    /* -1 into the border rows and columns (still involving modular arithmetic -> toric case), interior elsewhere */
 
-        delete[] worldDirection;
+    const int rowLength = Nx + 2;
+    std::fill(plane, plane + rowLength, -1);
+    for (int y = 1; y <= Ny; y++) {
+        int *row = plane + y * rowLength;
+        row[0] = -1;
+        std::fill(row + 1, row + Nx + 1, interior);
+        row[Nx + 1] = -1;
     }
+    // bottom border row and the spare cell behind it
+    std::fill(plane + (Ny + 1) * rowLength, plane + (Ny + 2) * rowLength + 1, -1);
+}
+
 
-    world = new int[(Ny + 2) * (Nx + 2) + 1];
-    worldNew = new int[(Ny + 2) * (Nx + 2) + 1];
+inline void CAbase::clearWorld() {
+    /* empty universe without reallocating: 0 for non-border cells and -1 for border cells */
 
-    worldColor = new int[(Ny + 2) * (Nx + 2) + 1];
-    worldColorNew = new int[(Ny + 2) * (Nx + 2) + 1];
+    CA_TRACE_SCOPE("CAbase", "clearWorld");
 
-    worldLifetime = new int[(Ny + 2) * (Nx + 2) + 1];
-    worldLifetimeNew = new int[(Ny + 2) * (Nx + 2) + 1];
+    nochanges = false;
+    agentsValid = false;
 
-    worldDirection = new int[(Ny + 2) * (Nx + 2) + 1];
+    clearPlane(world.get(), 0);
+    clearPlane(worldNew.get(), 0);
 
-    for (int i = 0; i <= (Ny + 2) * (Nx + 2); i++) {
-        // set border cells to -1 (still involving modular arithmetic -> toric case)
-        if ( (i < (Nx + 2)) || (i >= (Ny + 1) * (Nx + 2)) || (i % (Nx + 2) == 0) || (i % (Nx + 2) == (Nx + 1)) ) {
-            world[i] = -1;
-            worldNew[i] = -1;
+    clearPlane(worldColor.get(), 0);
+    clearPlane(worldColorNew.get(), 0);
 
-            worldColor[i] = -1;
-            worldColorNew[i] = -1;
+    clearPlane(worldLifetime.get(), CAexpiry::never);
+    clearPlane(worldLifetimeNew.get(), CAexpiry::never);
 
-            worldLifetime[i] = -1;
-            worldLifetimeNew[i] = -1;
+    std::fill(worldDirection.get(), worldDirection.get() + directionRows * (Nx + 2), -1);
+    std::fill(worldWinner.get(), worldWinner.get() + directionRows * (Nx + 2), 0);
+    memset(worldMarks.get(), 0, (Ny + 2) * (Nx + 2) + 1);
+}
+
+
+inline CAbase CAbase::clone() const {
+    /* deep copy, one memcpy per plane (the copy gets buffers of exactly its size)
+     *
+     * The copy is neither cleared first nor reseeded, so clone leaves the global rand()
+     * state alone.
+     */
+
+    CAbase c(Nx, Ny, uninitialized());
+    const int cells = (Ny + 2) * (Nx + 2) + 1;
+    const int windowCells = directionRows * (Nx + 2);
+
+    memcpy(c.world.get(), world.get(), cells * sizeof(int));
+    memcpy(c.worldNew.get(), worldNew.get(), cells * sizeof(int));
+    memcpy(c.worldColor.get(), worldColor.get(), cells * sizeof(int));
+    memcpy(c.worldColorNew.get(), worldColorNew.get(), cells * sizeof(int));
+    memcpy(c.worldLifetime.get(), worldLifetime.get(), cells * sizeof(int));
+    memcpy(c.worldLifetimeNew.get(), worldLifetimeNew.get(), cells * sizeof(int));
+    memcpy(c.worldDirection.get(), worldDirection.get(), windowCells * sizeof(int));
+    memcpy(c.worldWinner.get(), worldWinner.get(), windowCells * sizeof(int));
+    memcpy(c.worldMarks.get(), worldMarks.get(), cells);
+
+    c.directionSnake = directionSnake;
+    c.positionSnakeHead = positionSnakeHead;
+    c.positionFood = positionFood;
+    c.lifeTimeUI = lifeTimeUI;
+    c.nochanges = nochanges;
+    c.snakeAction = snakeAction;
+    c.snakeLength = snakeLength;
+    c.randomSeed = randomSeed;
+    c.generation = generation;
+    c.randomState = randomState;
+    return c;
+}
+
+
+// GAME OF LIFE
+inline void CAbase::putRandomSoup(int x0, int y0, int w, int h, double density) {
+    /* w x h cells from x0, y0 on alive with probability density, drawn from the board's random stream
+     *
+     * Every random number gives four cells (one byte each), which are compared with the
+     * threshold without branching.
+     */
 
-            worldDirection[i] = -1;
+    const unsigned int threshold = (unsigned int) qBound(0.0, density * 256.0 + 0.5, 256.0);
+    for (int iy = y0; iy < y0 + h; iy++) {
+        int *row = world.get() + iy * (Nx + 2) + x0;
+        int ix = 0;
+        for (; ix + 4 <= w; ix += 4) {
+            unsigned int r = nextRandom();
+            row[ix] = (r & 255) < threshold;
+            row[ix + 1] = ((r >> 8) & 255) < threshold;
+            row[ix + 2] = ((r >> 16) & 255) < threshold;
+            row[ix + 3] = (r >> 24) < threshold;
         }
-        else {
-            world[i] = 0;
-            worldNew[i] = 0;
+        unsigned int r = nextRandom();
+        for (; ix < w; ix++, r >>= 8) {
+            row[ix] = (r & 255) < threshold;
+        }
+    }
+    nochanges = false;
+    agentsValid = false;
+}
 
-            worldColor[i] = 0;
-            worldColorNew[i] = 0;
 
-            worldLifetime[i] = maxLifetime;
-            worldLifetimeNew[i] = maxLifetime;
+inline int CAbase::countLife() {
+    /* number of living cells */
 
-            worldDirection[i] = 0;
+    int n = 0;
+    for (int iy = 1; iy <= Ny; iy++) {
+        const int *row = world.get() + iy * (Nx + 2);
+        for (int ix = 1; ix <= Nx; ix++) {
+            n += row[ix];
         }
     }
+    return n;
 }
 
 
-// GAME OF LIFE
 inline int CAbase::cellEvolutionLife(int x, int y) {
     /* Rules
      *
@@ -266,6 +613,20 @@ inline int CAbase::cellEvolutionLife(int x, int y) {
 
 inline void CAbase::worldEvolutionLife() {
     /* apply cell evolution to the universe */
+
+    CA_TRACE_SCOPE("CAbase", "worldEvolutionLife");
+
+    agentsValid = false;
+    // fixed production sizes use a compile-time specialised torus grid
+    bool changed = false;
+    if (evolveLifeFixedSize<int, TorusBoundary>(world.get(), worldNew.get(), Nx, Ny, changed)) {
+        // every interior cell of worldNew was written and the halos are equal, so swapping suffices
+        std::swap(world, worldNew);
+        nochanges = !changed;
+        return;
+    }
+
+    // dynamic fallback for all other sizes
     for (int ix = 1; ix <= Nx; ix++) {
         for (int iy = 1; iy <= Ny; iy++) {
             cellEvolutionLife(ix, iy);
@@ -285,6 +646,53 @@ inline void CAbase::worldEvolutionLife() {
 }
 
 
+inline void CAbase::worldEvolutionLifeStrip() {
+    /* Life step of one strip of a larger torus (see StripCluster)
+     *
+     * The halo rows 0 and Ny + 1 hold the border rows of the neighbouring strips (ghost
+     * rows) and are read as they are; only the columns wrap around.
+     */
+
+    CA_TRACE_SCOPE("CAbase", "worldEvolutionLifeStrip");
+
+    agentsValid = false;
+    const int stride = Nx + 2;
+    int changed = 0;
+
+    for (int y = 1; y <= Ny; y++) {
+        const int *up = world.get() + (y - 1) * stride;
+        const int *mid = world.get() + y * stride;
+        const int *down = world.get() + (y + 1) * stride;
+        int *out = worldNew.get() + y * stride;
+
+        // the edge columns wrap, the columns in between need no checks
+        const int edges[2] = {1, Nx};
+        for (int x : edges) {
+            int left = (x > 1) ? x - 1 : Nx;
+            int right = (x < Nx) ? x + 1 : 1;
+            int n = (up[left] == 1) + (up[x] == 1) + (up[right] == 1) +
+                    (mid[left] == 1) + (mid[right] == 1) +
+                    (down[left] == 1) + (down[x] == 1) + (down[right] == 1);
+            int v = (n == 3) | ((mid[x] == 1) & (n == 2));
+            changed |= (v != mid[x]);
+            out[x] = v;
+        }
+        for (int x = 2; x < Nx; x++) {
+            int n = (up[x - 1] == 1) + (up[x] == 1) + (up[x + 1] == 1) +
+                    (mid[x - 1] == 1) + (mid[x + 1] == 1) +
+                    (down[x - 1] == 1) + (down[x] == 1) + (down[x + 1] == 1);
+            int v = (n == 3) | ((mid[x] == 1) & (n == 2));
+            changed |= (v != mid[x]);
+            out[x] = v;
+        }
+    }
+
+    // the interior of worldNew is complete, its halo rows are refilled before the next step
+    std::swap(world, worldNew);
+    nochanges = !changed;
+}
+
+
 // SNAKE
 inline CAbase::position CAbase::convert(int x, int y, int sD) {
     /* map snakeDirection to array/grid coordinates */
@@ -317,17 +725,32 @@ inline CAbase::position CAbase::convert(int x, int y, int sD) {
 inline void CAbase::putNewFood() {
     /* randomly put one piece of food on the field */
 
-    srand(time(NULL));
     bool locationFound = false;
-    int xFood, yFood;
+    int xFood(0), yFood(0);
+
+    // the snake fills the whole field, there is no spot left
+    if (snakeLength >= Nx * Ny) return;
 
     /* only put food in empty spots */
-    while (!locationFound) {
-        xFood = rand() % Nx + 1;
-        yFood = rand() % Ny + 1;
-        int v = getValue(xFood, yFood);
-        if (v != 0) continue;
-        locationFound = true;
+    for (int attempt = 0; attempt < 64 && !locationFound; attempt++) {
+        xFood = nextRandom() % Nx + 1;
+        yFood = nextRandom() % Ny + 1;
+        if (getValue(xFood, yFood) == 0) locationFound = true;
+    }
+
+    /* nearly full field: pick one of the remaining empty spots directly */
+    if (!locationFound) {
+        int k = nextRandom() % (Nx * Ny - snakeLength);
+        for (int y = 1; y <= Ny && !locationFound; y++) {
+            for (int x = 1; x <= Nx && !locationFound; x++) {
+                if (getValue(x, y) == 0 && k-- == 0) {
+                    xFood = x;
+                    yFood = y;
+                    locationFound = true;
+                }
+            }
+        }
+        if (!locationFound) return;
     }
     positionFood.x = xFood;
     positionFood.y = yFood;
@@ -358,6 +781,16 @@ inline void CAbase::putInitSnake(){
 }
 
 
+inline void CAbase::turnSnake(int dS) {
+    /* opposing directions add up to 10 (2 + 8, 4 + 6), so past and future must NOT do so */
+    if (dS + directionSnake.past == 10) {
+        directionSnake.future = directionSnake.past; // continue with past direction if input is "invalid"
+    } else {
+        directionSnake.future = dS;
+    }
+}
+
+
 inline void CAbase::calcSnakeAction(){
     /* calculate the next action of the snake (move / move and feed / die) */
 
@@ -376,7 +809,7 @@ inline void CAbase::calcSnakeAction(){
         }
     }
 
-#ifndef QT_DEBUG
+#ifdef SNAKE_DEBUG
     qDebug() << "positionSnakeHead: " << positionSnakeHead.x << " " << positionSnakeHead.y;
     qDebug("Neighborhood of SnakeHead");
     for (int i = 0; i <= 2; i++) {
@@ -432,11 +865,14 @@ inline void CAbase::worldEvolutionSnake() {
      * It grows by feeding - one piece of food at a time.
      */
 
+    CA_TRACE_SCOPE("CAbase", "worldEvolutionSnake");
+
+    agentsValid = false;
     // calculate upcoming snake action
     calcSnakeAction();
     int dS = directionSnake.future;
 
-#ifndef QT_DEBUG
+#ifdef SNAKE_DEBUG
     qDebug() << "action: " << snakeAction;
     qDebug() << "future_dir: " << directionSnake.future << " " << "past_dir: " << directionSnake.past;
     qDebug() << "slen: " << snakeLength;
@@ -451,14 +887,14 @@ inline void CAbase::worldEvolutionSnake() {
                 int v = getValue(x, y);
                 // head
                 if (v == 10) {
-#ifndef QT_DEBUG
+#ifdef SNAKE_DEBUG
                     qDebug() << "(x, y) = (" << x << ", " << y << ")  -> (" << convert(x, y, dS).x << ", " << convert(x, y, dS).y << ")";
 #endif
                     setValueNew(x, y, v + 1);
                     setValueNew(convert(x, y, dS).x, convert(x, y, dS).y, 10);
                     positionSnakeHead.x = convert(x, y, dS).x;
                     positionSnakeHead.y = convert(x, y, dS).y;
-#ifndef QT_DEBUG
+#ifdef SNAKE_DEBUG
                     qDebug() << "sH: " << positionSnakeHead.x << " " << positionSnakeHead.y;
 #endif
                 // body
@@ -525,139 +961,190 @@ inline void CAbase::worldEvolutionSnake() {
     }
 }
 
+inline unsigned int CAbase::nextRandom() {
+    /* next number of the board's own random stream (xorshift64*), independent of rand() */
+
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    if (randomState == 0) randomState = 0x9E3779B97F4A7C15ULL;
+    return (unsigned int) ((randomState * 0x2545F4914F6CDD1DULL) >> 33);
+}
+
+
 // PREDATOR
+inline CAview CAbase::view() const {
+    /* current universe and snake metadata without copying (see CAview) */
+
+    CAview v;
+    v.world = world.get();
+    v.lifetime = worldLifetime.get();
+    v.nx = Nx;
+    v.ny = Ny;
+    v.directionPast = directionSnake.past;
+    v.directionFuture = directionSnake.future;
+    v.headX = positionSnakeHead.x;
+    v.headY = positionSnakeHead.y;
+    v.foodX = positionFood.x;
+    v.foodY = positionFood.y;
+    v.snakeLength = snakeLength;
+    v.snakeAction = snakeAction;
+    v.generation = generation;
+    v.nochanges = nochanges;
+    return v;
+}
+
+
+inline CAsnapshot CAbase::snapshot() const {
+    /* one copy of the universe and lifetime planes, shared by every copy of the returned snapshot */
+
+    int cells = (Ny + 2) * (Nx + 2) + 1;
+    std::shared_ptr<CAsnapshot::planes> p = std::make_shared<CAsnapshot::planes>();
+    p->world.assign(world.get(), world.get() + cells);
+    p->lifetime.assign(worldLifetime.get(), worldLifetime.get() + cells);
+    p->view = view();
+    p->view.world = p->world.data();
+    p->view.lifetime = p->lifetime.data();
+
+    CAsnapshot s;
+    s.data = p;
+    return s;
+}
+
+
+inline unsigned int CAbase::cellRandom(int x, int y, int phase) {
+    /* random number for cell x, y in the given phase of the current generation
+     *
+     * The number only depends on seed, generation, cell and phase, so the outcome of a
+     * step does not depend on the order in which the cells are visited.
+     */
+
+    uint64_t z = (uint64_t(randomSeed) << 32 | generation) * 0x9E3779B97F4A7C15ULL;
+    z ^= uint64_t(uint32_t(y * (Nx + 2) + x)) << 2 | uint32_t(phase);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (unsigned int) (z >> 33);
+}
+
+
 inline void CAbase::cellEvolutionConsistency(int x, int y) {
-    /* rectify directions so that at most one neighbor is incoming */
+    /* pick the one incoming neighbor that may move into cell x, y
+     *
+     * Pure gather: only the winner of cell x, y is written (0 for none, otherwise the
+     * neighbor index 1 down, 2 left, 3 right, 4 up). Every other incoming neighbor
+     * learns from this winner in cellEvolutionMove that it has to stay.
+     */
 
     int neighborhoodDirections[5] {0};
-    neighborhoodDirections[0] = getDirection(x, y);
     neighborhoodDirections[1] = getDirection(x, y + 1); // down
     neighborhoodDirections[2] = getDirection(x - 1, y); // left
     neighborhoodDirections[3] = getDirection(x + 1, y); // right
     neighborhoodDirections[4] = getDirection(x, y - 1); // up
 
     int neighborhoodLifetimes[5] {0};
-    neighborhoodLifetimes[0] = getLifetime(x, y);
     neighborhoodLifetimes[1] = getLifetime(x, y + 1); // down
     neighborhoodLifetimes[2] = getLifetime(x - 1, y); // left
     neighborhoodLifetimes[3] = getLifetime(x + 1, y); // right
     neighborhoodLifetimes[4] = getLifetime(x, y - 1); // up
 
-    int incomingNeighbors[5] {0};
     int incomingViableNeighbors[5] {0};
-
-    int n_sum = 0; // # of incoming neighbors
     int nv_sum = 0; // # of incoming viable neighbors
 
-    // compute incoming and "viable" incoming neighbors
+    // a viable incoming neighbor aims at this cell and has a positive lifetime
     for (int i = 1; i < 5; i++) {
-        if (neighborhoodDirections[i] + 2 * i == 10) {
-            incomingNeighbors[i] = 1;
-            n_sum++;
-            if (neighborhoodLifetimes[i] > 0) { // a viable incoming neighbor must have a positive lifetime
-                incomingViableNeighbors[i] = 1;
-                nv_sum++;
-            }
+        if (neighborhoodDirections[i] + 2 * i == 10 && neighborhoodLifetimes[i] > 0) {
+            incomingViableNeighbors[i] = 1;
+            nv_sum++;
         }
     }
 
-    // no viable incoming neighbor -> all incoming neighbors won't move
-    if (nv_sum == 0) {
-        for (int i = 1; i < 5; i++) {
-            if (incomingNeighbors[i] == 1) {
-                CAbase::position incomingCellCoordinates = CAbase::convert(x, y, 2 * i);
-                setDirection(incomingCellCoordinates.x, incomingCellCoordinates.y, 0);
-            }
-        }
-    }
-    // exactly one viable incoming neighbor -> all other incoming neighbors won't move
-    else if (nv_sum == 1) {
-        for (int i = 1; i < 5; i++) {
-            if (incomingNeighbors[i] == 1 && incomingViableNeighbors[i] != 1) {
-                CAbase::position incomingCellCoordinates = CAbase::convert(x, y, 2 * i);
-                setDirection(incomingCellCoordinates.x, incomingCellCoordinates.y, 0);
-            }
+    int winner = 0;
+    if (nv_sum == 1) { // exactly one viable incoming neighbor
+        winner = 1;
+        while (incomingViableNeighbors[winner] != 1) {
+            winner++;
         }
-    }
-    // more than one viable incoming neighbor -> randomly pick one; all other incoming neighbors won't move
-    else {
-        int r = rand() % nv_sum + 1;
-        for (int i = 1; i < 5; i++) {
-            if (incomingNeighbors[i] == 1) {
-                CAbase::position incomingCellCoordinates = CAbase::convert(x, y, 2 * i);
-                if (incomingViableNeighbors[i] == 1) {
-                    r -= 1;
-                    if (r != 0) { // these incoming viable neighbors won't move
-                        setDirection(incomingCellCoordinates.x, incomingCellCoordinates.y, 0);
-                    }
-                }
-                else { // these incoming non-viable neighbors won't move
-                    setDirection(incomingCellCoordinates.x, incomingCellCoordinates.y, 0);
-                }
+    } else if (nv_sum > 1) { // more than one viable incoming neighbor -> randomly pick one
+        int r = cellRandom(x, y, 1) % nv_sum + 1;
+        while (r > 0) {
+            winner++;
+            if (incomingViableNeighbors[winner] == 1) {
+                r -= 1;
             }
         }
     }
+    setWinner(x, y, winner);
 }
 
 
 inline void CAbase::cellEvolutionMove(int x, int y) {
     /* compute new value and new lifetime of cell x, y */
 
-    int lifeTime = getLifetime(x, y);
-    int value = getValue(x, y);
-
-    int neighborhoodDirections[5];
-    neighborhoodDirections[0] = getDirection(x, y);
-    neighborhoodDirections[1] = getDirection(x, y + 1); // down
-    neighborhoodDirections[2] = getDirection(x - 1, y); // left
-    neighborhoodDirections[3] = getDirection(x + 1, y); // right
-    neighborhoodDirections[4] = getDirection(x, y - 1); // up
-
-    int incomingNeighbors[5] {0};
-    int n_sum = 0;
-    for (int i = 0; i < 5; i++) {
-        if (neighborhoodDirections[i] + 2 * i == 10) {
-            incomingNeighbors[i] = 1;
-            n_sum++;
+    // the cell itself only moves if it won at its target
+    int direction = getDirection(x, y);
+    if (direction != 0) {
+        position target = convert(x, y, direction);
+        if (getWinner(target.x, target.y) != (10 - direction) / 2) {
+            direction = 0;
         }
     }
 
-    if (n_sum == 0) { // no neighbor aims at this cell
-        if (neighborhoodDirections[0] == 0) { // cell itself has no aim
-            if (lifeTime == maxLifetime) { // non-living cell
-                setValueNew(x, y, getValue(x, y));
-                setLifetimeNew(x, y, maxLifetime);
+    int incoming = getWinner(x, y);
+    int incomingValue = 0;
+    int incomingExpiry = CAexpiry::never;
+    if (incoming != 0) {
+        position incomingCellCoordinates = convert(x, y, 2 * incoming);
+        incomingValue = getValue(incomingCellCoordinates.x, incomingCellCoordinates.y);
+        incomingExpiry = getExpiry(incomingCellCoordinates.x, incomingCellCoordinates.y);
+    }
+
+    int value, expiry;
+    cellNextState(getValue(x, y), getExpiry(x, y), direction != 0, incoming != 0,
+                  incomingValue, incomingExpiry, value, expiry);
+    setValueNew(x, y, value);
+    setExpiryNew(x, y, expiry);
+}
+
+
+inline void CAbase::cellNextState(int value, int expiry, bool movesAway, bool hasIncoming,
+                                  int incomingValue, int incomingExpiry, int &newValue, int &newExpiry) {
+    /* new value and expiry of a cell from its own state and the neighbor moving into it
+     *
+     * In countdowns: a living cell that stays or moves is one generation older, which
+     * leaves its expiry as it is.
+     */
+
+    if (!hasIncoming) { // no neighbor moves into this cell
+        if (!movesAway) { // cell itself stays
+            if (expiry == CAexpiry::never) { // non-living cell
+                newValue = value;
+                newExpiry = CAexpiry::never;
             } else { // living cell
-                if (lifeTime > 0) { // living cell grows older
-                    setValueNew(x, y, getValue(x, y));
-                    setLifetimeNew(x, y, lifeTime - 1);
+                if (CAexpiry::lifetime(expiry, generation) > 0) { // living cell grows older
+                    newValue = value;
+                    newExpiry = expiry;
                 }
                 else { // living cell dies/disappears
-                    setValueNew(x, y, 0);
-                    setLifetimeNew(x, y, maxLifetime);
+                    newValue = 0;
+                    newExpiry = CAexpiry::never;
                 }
             }
 
-        } else { // cell itself aims at a legal position
-            setValueNew(x, y, 0);
-            setLifetimeNew(x, y, maxLifetime);
+        } else { // cell itself moves away
+            newValue = 0;
+            newExpiry = CAexpiry::never;
         }
 
-    } else if (n_sum == 1) { // exactly one living neighbor aims at this cell
-        int i = 1;
-        while (incomingNeighbors[i] != 1) {
-            i++;
-        }
-        position incomingCellCoordinates = convert(x, y, 2 * i);
-        setValueNew(x, y, getValue(incomingCellCoordinates.x, incomingCellCoordinates.y));
+    } else { // exactly one living neighbor moves into this cell
+        newValue = incomingValue;
         if (value == 2 || value == 5) { // cell is devoured
-            setLifetimeNew(x, y, lifeTimeUI);
+            newExpiry = CAexpiry::stamp(lifeTimeUI, generation + 1);
+        } else if (incomingExpiry == CAexpiry::never) { // a cell without a limit starts counting down once it moves
+            newExpiry = CAexpiry::stamp(maxLifetime - 1, generation + 1);
         } else {
-            setLifetimeNew(x, y, getLifetime(incomingCellCoordinates.x, incomingCellCoordinates.y) - 1);
+            newExpiry = incomingExpiry;
         }
-
-    } else if (n_sum > 1) {
-        qWarning() << "More than one neighbor aims at a cell!";
     }
 }
 
@@ -665,188 +1152,310 @@ inline void CAbase::cellEvolutionMove(int x, int y) {
 inline void CAbase::cellEvolutionDirection(int x, int y) {
     /* set a preliminary moving direction for cell x, y */
 
-    int neighbors[5];
-    neighbors[0] = getValue(x, y);
-    neighbors[1] = getValue(x, y + 1); // down
-    neighbors[2] = getValue(x - 1, y); // left
-    neighbors[3] = getValue(x + 1, y); // right
-    neighbors[4] = getValue(x, y - 1); // up
-    int n_sum = 0;
+    setDirection(x, y, cellDirection(x, y));
+}
 
-    // PREDATOR
+
+inline int CAbase::candidateDirections(const int neighbors[5]) {
+    /* the directions cell neighbors[0] may choose among, bit i - 1 for neighbor i (1 down, 2 left, 3 right, 4 up) */
+
+    int preyNeighbors = 0;
+    int predatorNeighbors = 0;
+    int foodNeighbors = 0;
+    int allowedPredator = 0; // excluding neighboring predators, boundary and food
+    int allowedPrey = 0;     // excluding neighboring prey and boundary
+    for (int i = 1; i <= 4; i++) {
+        int bit = 1 << (i - 1);
+        if (neighbors[i] == 2) preyNeighbors |= bit;
+        if (neighbors[i] == 1) predatorNeighbors |= bit;
+        if (neighbors[i] == 5) foodNeighbors |= bit;
+        if (neighbors[i] != 1 && neighbors[i] != -1 && neighbors[i] != 5) allowedPredator |= bit;
+        if (neighbors[i] != 2 && neighbors[i] != -1) allowedPrey |= bit;
+    }
+
+    // PREDATOR: towards prey if there is any, otherwise anywhere allowed
     if (neighbors[0] == 1) {
-        int preyNeighbors[5] {0};
+        return preyNeighbors ? preyNeighbors : allowedPredator;
+    }
 
-        for (int i = 1; i <= 4; i++) {
-            if (neighbors[i] == 2) {
-                preyNeighbors[i] = 1;
-                n_sum++;
+    // PREY: freezes next to a predator, otherwise towards food if there is any, otherwise anywhere allowed
+    if (neighbors[0] == 2) {
+        if (predatorNeighbors) return 0;
+        return foodNeighbors ? foodNeighbors : allowedPrey;
+    }
+
+    // FOOD OR EMPTY CELL
+    return 0;
+}
+
+
+inline const CAbase::predatorTable &CAbase::predatorRules() {
+    /* candidateDirections for every neighborhood of state classes, and the k-th set bit of every mask */
+
+    static const predatorTable table = []() {
+        static const int classValues[5] = {0, 1, 2, 5, -1}; // empty, predator, prey, food, boundary
+        predatorTable t;
+        for (int code = 0; code < predatorTable::neighborhoods; code++) {
+            int neighbors[5];
+            for (int i = 0, c = code; i < 5; i++, c /= 5) {
+                neighbors[i] = classValues[c % 5];
             }
+            t.mask[code] = (unsigned char) candidateDirections(neighbors);
         }
-
-        // NO PREY IN NEIGHBORHOOD
-        if (n_sum == 0) {
-            int allowedDirections[5] {0};
-            int na_sum = 0;
-            for (int i = 1; i < 5; i++) { // determine which directions are "allowed"
-                if (neighbors[i] != 1 && neighbors[i] != -1 && neighbors[i] != 5) { // excluding neighboring predators, boundary and food
-                    allowedDirections[i] = 1;
-                    na_sum++;
-                }
+        for (int mask = 0; mask < 16; mask++) {
+            int n = 0;
+            for (int i = 1; i <= 4; i++) {
+                if (mask & (1 << (i - 1))) t.direction[mask][n++] = (unsigned char) (2 * i);
             }
-            if (na_sum == 0) { // no allowed direction
-                setDirection(x, y, 0);
-            } else if (na_sum == 1) { // exactly one direction is allowed
-                int i = 1;
-                while (allowedDirections[i] != 1) {
-                    i++;
-                }
-                setDirection(x, y, 2 * i);
-            } else if (na_sum > 1) { // more than one direction is allowed
-                int r = rand() % (na_sum) + 1;
-                int i = 0;
-                while (r > 0) {
-                    i += 1;
-                    if (allowedDirections[i] == 1) {
-                        r -= 1;
-                    }
-                }
-                setDirection(x, y, 2 * i);
+            t.count[mask] = (unsigned char) n;
+            for (int k = n; k < 4; k++) {
+                t.direction[mask][k] = 0;
             }
+        }
+        return t;
+    }();
+    return table;
+}
 
-        // EXACTLY ONE PREY ITEM IN NEIGHBORHOOD
-        } else if (n_sum == 1) {
-            int i = 1;
-            while (preyNeighbors[i] != 1) {
-                i++;
-            }
-            setDirection(x, y, 2 * i);
-
-        // MOVE TOWARDS A RANDOM PREY NEIGHBOR
-        } else if (n_sum > 1) {
-            int r = rand() % (n_sum) + 1;
-            int i = 0;
-            while (r > 0) {
-                i += 1;
-                if (preyNeighbors[i] == 1) {
-                    r -= 1;
-                }
+
+inline int CAbase::cellDirection(int x, int y) {
+    /* preliminary moving direction of cell x, y: 0 stay, 2 down, 4 left, 6 right, 8 up
+     *
+     * The neighborhood is reduced to five state classes and looked up in predatorRules;
+     * a random number is only drawn when there is more than one candidate, and picks the
+     * k-th of them in the order down, left, right, up.
+     */
+
+    const int *cell = world.get() + y * (Nx + 2) + x;
+    int code = stateClass(cell[0]) + 5 * stateClass(cell[Nx + 2]) + 25 * stateClass(cell[-1]) +
+               125 * stateClass(cell[1]) + 625 * stateClass(cell[-(Nx + 2)]);
+
+    const predatorTable &rules = predatorRules();
+    int mask = rules.mask[code];
+    int n = rules.count[mask];
+    int k = (n > 1) ? int(cellRandom(x, y, 0) % n) : 0;
+    return rules.direction[mask][k];
+}
+
+
+inline void CAbase::putRandomPredator(double density, int lifetime) {
+    /* occupy each cell with probability density, split evenly into predator, prey and food */
+
+    for (int iy = 1; iy <= Ny; iy++) {
+        for (int ix = 1; ix <= Nx; ix++) {
+            double p = cellRandom(ix, iy, 2) / 2147483648.0;
+            if (p < density / 3) {
+                setValue(ix, iy, 1);
+                setLifetime(ix, iy, lifetime);
+            } else if (p < 2 * density / 3) {
+                setValue(ix, iy, 2);
+                setLifetime(ix, iy, lifetime);
+            } else if (p < density) {
+                setValue(ix, iy, 5);
+                setLifetime(ix, iy, maxLifetime);
+            } else {
+                setValue(ix, iy, 0);
+                setLifetime(ix, iy, maxLifetime);
             }
-            setDirection(x, y, 2 * i);
         }
+    }
+}
+
+
+inline void CAbase::countPredator(int &predators, int &prey, int &food) {
+    /* count the cells of each predator-prey state */
+
+    predators = prey = food = 0;
+    for (int iy = 1; iy <= Ny; iy++) {
+        for (int ix = 1; ix <= Nx; ix++) {
+            int v = world[iy * (Nx + 2) + ix];
+            predators += (v == 1);
+            prey += (v == 2);
+            food += (v == 5);
+        }
+    }
+}
+
 
-    // PREY
-    } else if (neighbors[0] == 2) {
-        bool hasPredatorNeighbor {false};
-        for (int i = 1; i <= 4; i++) {
-            if (neighbors[i] == 1) {
-                hasPredatorNeighbor = true;
-                break;
+inline void CAbase::worldEvolutionPredator() {
+    /* combine evolutionary functions on cell level to array level
+     *
+     * Only agents (predators, prey and cells with a limited lifetime) change on their own,
+     * and they only change themselves and the cells they move into. Once a step has listed
+     * them, boards with few agents are stepped from that list; the list is rebuilt by a
+     * full step after any other write to the board. Both steps give the same result, as
+     * every random choice comes from cellRandom.
+     */
+
+    CA_TRACE_SCOPE("CAbase", "worldEvolutionPredator");
+
+    // one agent touches up to two cells in scattered places, a full step streams over all of them
+    if (agentsValid && 8 * qint64(agents.size()) <= qint64(Nx) * Ny) {
+        worldEvolutionPredatorAgents();
+    } else {
+        worldEvolutionPredatorDense();
+    }
+    agentsValid = true;
+    generation++;
+}
+
+
+inline void CAbase::worldEvolutionPredatorDense() {
+    /* every cell of the board, listing the agents on the way
+     *
+     * Every phase is a stencil that only writes the cell it is called for, so the phases
+     * can run as a wavefront over the rows: in step t the directions of row t are computed,
+     * the winners of row t - 1 are picked, row t - 2 moves and row t - 3 is written back.
+     * Only directionRows rows of directions and winners are kept, and every row of world
+     * and worldLifetime is visited while it is still in cache.
+     */
+
+    CA_TRACE_SCOPE("CAbase", "worldEvolutionPredatorDense");
+
+    const int rowLength = Nx + 2;
+    nochanges = true;
+    agents.clear();
+
+    for (int t = 0; t <= Ny + 3; t++) {
+        // calculate a priori possible moving directions for row t (border rows never aim anywhere)
+        if (t == 0 || t == Ny + 1) {
+            for (int ix = 0; ix <= Nx + 1; ix++) {
+                setDirection(ix, t, -1);
+            }
+        } else if (t <= Ny) {
+            setDirection(0, t, -1);
+            setDirection(Nx + 1, t, -1);
+            for (int ix = 1; ix <= Nx; ix++) {
+                cellEvolutionDirection(ix, t);
             }
         }
 
-        if (hasPredatorNeighbor) { // freeze
-            setDirection(x, y, 0);
+        // pick at most one incoming viable neighbor for each cell of row t - 1
+        int c = t - 1;
+        if (c >= 1 && c <= Ny) {
+            for (int ix = 1; ix <= Nx; ix++) {
+                cellEvolutionConsistency(ix, c);
+            }
         }
-        else {
-            int foodNeighbors[5] {0};
-            for (int i = 1; i <= 4; i++) {
-                if (neighbors[i] == 5) {
-                    foodNeighbors[i] = 1;
-                    n_sum++;
-                }
+
+        // calculate new status and new lifetime for row t - 2, whose neighbors' winners are known now
+        int m = t - 2;
+        if (m >= 1 && m <= Ny) {
+            for (int ix = 1; ix <= Nx; ix++) {
+                cellEvolutionMove(ix, m);
             }
-            // NO FOOD NEIGBHOR
-            if (n_sum == 0) {
-                int allowedDirections[5] {0};
-                int na_sum = 0;
-                for (int i = 1; i < 5; i++) { // determine which directions are "allowed"
-                    if (neighbors[i] != 2 && neighbors[i] != -1) { // excluding neighboring prey and boundary
-                        allowedDirections[i] = 1;
-                        na_sum++;
-                    }
-                }
-                if (na_sum == 0) { // no allowed direction
-                    setDirection(x, y, 0);
-                } else if (na_sum == 1) { // exactly one direction is allowed
-                    int i = 1;
-                    while (allowedDirections[i] != 1) {
-                        i++;
-                    }
-                    setDirection(x, y, 2 * i);
-                } else if (na_sum > 1) { // more than one direction is allowed
-                    int r = rand() % (na_sum) + 1;
-                    int i = 0;
-                    while (r > 0) {
-                        i += 1;
-                        if (allowedDirections[i] == 1) {
-                            r -= 1;
-                        }
-                    }
-                    setDirection(x, y, 2 * i);
-                }
-            // EXACTLY ONE FOOD NEIGHBOR
-            } else if (n_sum == 1) { // move towards this food neighbor
-                int i = 1;
-                while (foodNeighbors[i] != 1) {
-                    i++;
+        }
+
+        // row t - 3 is not read any more in this generation
+        int w = t - 3;
+        if (w >= 1 && w <= Ny) {
+            for (int ix = w * rowLength + 1; ix <= w * rowLength + Nx; ix++) {
+                // game goes on while at least one cell has lifetime >=0 and less than maxLifetime, so this cell isn't food or empty
+                int lifeTime = CAexpiry::lifetime(worldLifetimeNew[ix], generation + 1);
+                if ((lifeTime >= 0) && (lifeTime < maxLifetime)) {
+                    nochanges = false;
                 }
-                setDirection(x, y, 2 * i);
-            // MORE THAN ONE FOOD NEIGHBOR
-            } else if (n_sum > 1) { // randomly move towards a random food neighbor
-                int r = rand() % (n_sum) + 1;
-                int i = 0;
-                while (r > 0) {
-                    i++;
-                    if (foodNeighbors[i] == 1) {
-                        r -= 1;
-                    }
+                // transfer array values from new to current
+                world[ix] = worldNew[ix];
+                worldLifetime[ix] = worldLifetimeNew[ix];
+                if (world[ix] == 1 || world[ix] == 2 || worldLifetime[ix] != CAexpiry::never) {
+                    agents.push_back(ix);
                 }
-                setDirection(x, y, 2 * i);
             }
         }
-
-    // FOOD OR EMPTY CELL
-    } else {
-        setDirection(x, y, 0);
     }
 }
 
 
-inline void CAbase::worldEvolutionPredator() {
-    /* combine evolutionary functions on cell level to array level */
+inline void CAbase::worldEvolutionPredatorAgents() {
+    /* the same step as worldEvolutionPredatorDense, visiting only the agents and their targets
+     *
+     * An agent that may move marks its target with the neighbor index it comes from
+     * (1 down, 2 left, 3 right, 4 up, as in cellEvolutionConsistency); the winner of each
+     * target is kept in the same byte of worldMarks. The new states are computed from the
+     * old board and written back together, into both planes of each kind, which keeps the
+     * evolution planes a copy of the current universe.
+     */
 
-    // calculate a priori possible moving directions for each cell
-    for (int ix = 1; ix <= Nx; ix++) {
-        for (int iy = 1; iy <= Ny; iy++) {
-            cellEvolutionDirection(ix, iy);
+    CA_TRACE_SCOPE("CAbase", "worldEvolutionPredatorAgents");
+
+    const unsigned char listed = 1;
+    const int rowLength = Nx + 2;
+    const int offset[5] = {0, rowLength, -1, 1, -rowLength}; // neighbor i of a cell, direction 2 * i
+    const int agentCount = int(agents.size());
+    unsigned char *marks = worldMarks.get();
+
+    // directions of the agents, viable movers claim their targets
+    agentCells.assign(agents.begin(), agents.end());
+    agentMoves.resize(agentCount);
+    for (int k = 0; k < agentCount; k++) {
+        marks[agents[k]] = listed;
+    }
+    for (int k = 0; k < agentCount; k++) {
+        int p = agents[k];
+        int direction = (world[p] == 1 || world[p] == 2) ? cellDirection(p % rowLength, p / rowLength) : 0;
+        agentMoves[k] = direction;
+        if (direction != 0 && CAexpiry::lifetime(worldLifetime[p], generation) > 0) {
+            int q = p + offset[direction / 2];
+            if (!(marks[q] & listed)) {
+                marks[q] |= listed;
+                agentCells.push_back(q);
+            }
+            marks[q] |= 1 << ((10 - direction) / 2);
         }
     }
 
-    // make sure there is at most one incoming viable neighbor for each cell
-    for (int ix = 1; ix <= Nx; ix++) {
-        for (int iy = 1; iy <= Ny; iy++) {
-            cellEvolutionConsistency(ix, iy);
+    // pick one winner for each claimed cell (bits 1 to 4 are the claims, the winner goes into bits 5 to 7)
+    const int cellCount = int(agentCells.size());
+    for (int k = 0; k < cellCount; k++) {
+        int q = agentCells[k];
+        int claims = (marks[q] >> 1) & 15;
+        if (claims == 0) continue;
+        int winner = 0;
+        int n = ((claims >> 0) & 1) + ((claims >> 1) & 1) + ((claims >> 2) & 1) + ((claims >> 3) & 1);
+        int r = (n == 1) ? 1 : int(cellRandom(q % rowLength, q / rowLength, 1) % n) + 1;
+        while (r > 0) {
+            winner++;
+            if (claims & (1 << (winner - 1))) {
+                r -= 1;
+            }
         }
+        marks[q] = (unsigned char) (marks[q] | (winner << 5));
     }
 
-    // calculate new status and new lifetime for each cell
-    for (int ix = 1; ix <= Nx; ix++) {
-        for (int iy = 1; iy <= Ny; iy++) {
-            cellEvolutionMove(ix, iy);
-        }
+    // new states from the old board
+    agentMoves.resize(agentCount + 2 * cellCount);
+    int *next = agentMoves.data() + agentCount;
+    for (int k = 0; k < cellCount; k++) {
+        int q = agentCells[k];
+        int direction = (k < agentCount) ? agentMoves[k] : 0;
+        bool movesAway = direction != 0 && (marks[q + offset[direction / 2]] >> 5) == (10 - direction) / 2;
+        int incoming = marks[q] >> 5;
+        int source = q + offset[incoming];
+        cellNextState(world[q], worldLifetime[q], movesAway, incoming != 0,
+                      world[source], worldLifetime[source], next[2 * k], next[2 * k + 1]);
     }
 
+    // write back the cells whose occupant moved, was born or died, and list the agents of the next generation
     nochanges = true;
-    for (int ix = 1; ix <= Nx; ix++) {
-        for (int iy = 1; iy <= Ny; iy++) {
-            // game goes on while at least one cell has lifetime >=0 and less than maxLifetime, so this cell isn't food or empty
-            if ((worldLifetimeNew[iy * (Nx + 2) + ix] >= 0) && (worldLifetimeNew[iy * (Nx + 2) + ix] < maxLifetime)) {
-                nochanges = false;
-            }
-            // transfer array values from new to current
-            world[iy * (Nx + 2) + ix] = worldNew[iy * (Nx + 2) + ix];
-            worldLifetime[iy * (Nx + 2) + ix] = worldLifetimeNew[iy * (Nx + 2) + ix];
+    agents.clear();
+    for (int k = 0; k < cellCount; k++) {
+        int q = agentCells[k];
+        int value = next[2 * k];
+        int expiry = next[2 * k + 1];
+        if (world[q] != value) {
+            world[q] = worldNew[q] = value;
+        }
+        if (worldLifetime[q] != expiry) {
+            worldLifetime[q] = worldLifetimeNew[q] = expiry;
+        }
+        marks[q] = 0;
+        int lifeTime = CAexpiry::lifetime(expiry, generation + 1);
+        if (lifeTime >= 0 && lifeTime < maxLifetime) {
+            nochanges = false;
+        }
+        if (value == 1 || value == 2 || expiry != CAexpiry::never) {
+            agents.push_back(q);
         }
     }
 }
@@ -0,0 +1,121 @@
+#ifndef CAGRID_H
+#define CAGRID_H
+
+/* compile-time specialised grids
+ *
+ * CAGrid works on the same memory layout as CAbase: an interior of W x H cells with
+ * coordinates 1..W / 1..H surrounded by a one cell wide halo, stored row by row with a
+ * stride of W + 2. Size, stride and boundary policy are template parameters, so the inner
+ * loops have constant bounds the compiler can unroll and vectorise.
+ */
+
+
+// BOUNDARY POLICIES
+// map(c, n) maps a neighbour coordinate (0..n + 1) to the cell that is read instead
+struct TorusBoundary {
+    // opposite edges are neighbours
+    static constexpr int map(int c, int n) {
+        return (c < 1) ? n : ((c > n) ? 1 : c);
+    }
+};
+
+
+template <typename CellT, int W, int H, typename BoundaryPolicy>
+class CAGrid {
+
+public:
+    static constexpr int width = W;
+    static constexpr int height = H;
+    static constexpr int stride = W + 2;
+    static constexpr int cellCount = (W + 2) * (H + 2);
+
+    static constexpr int index(int x, int y) {
+        return y * stride + x;
+    }
+
+    // GAME OF LIFE
+    static bool evolveLife(const CellT *world, CellT *worldNew);
+
+private:
+    static int lifeRule(CellT centre, int n) {
+        // see CAbase::cellEvolutionLife for the rules
+        return (n == 3) | ((centre == 1) & (n == 2));
+    }
+};
+
+
+template <typename CellT, int W, int H, typename BoundaryPolicy>
+inline bool CAGrid<CellT, W, H, BoundaryPolicy>::evolveLife(const CellT *world, CellT *worldNew) {
+    /* write the next Life generation of every interior cell into worldNew, return whether anything changed */
+
+    static_assert(W >= 3 && H >= 3, "CAGrid needs at least 3 x 3 cells");
+
+    const int left = BoundaryPolicy::map(0, W);
+    const int right = BoundaryPolicy::map(W + 1, W);
+    int changed = 0;
+
+    for (int y = 1; y <= H; y++) {
+        const CellT *up = world + BoundaryPolicy::map(y - 1, H) * stride;
+        const CellT *mid = world + y * stride;
+        const CellT *down = world + BoundaryPolicy::map(y + 1, H) * stride;
+        CellT *out = worldNew + y * stride;
+
+        // left edge
+        int n = (up[left] == 1) + (up[1] == 1) + (up[2] == 1) +
+                (mid[left] == 1) + (mid[2] == 1) +
+                (down[left] == 1) + (down[1] == 1) + (down[2] == 1);
+        out[1] = CellT(lifeRule(mid[1], n));
+        changed |= (out[1] != mid[1]);
+
+        // interior: constant bounds, no boundary branches
+        for (int x = 2; x < W; x++) {
+            int s = (up[x - 1] == 1) + (up[x] == 1) + (up[x + 1] == 1) +
+                    (mid[x - 1] == 1) + (mid[x + 1] == 1) +
+                    (down[x - 1] == 1) + (down[x] == 1) + (down[x + 1] == 1);
+            CellT v = CellT(lifeRule(mid[x], s));
+            changed |= (v != mid[x]);
+            out[x] = v;
+        }
+
+        // right edge
+        n = (up[W - 1] == 1) + (up[W] == 1) + (up[right] == 1) +
+            (mid[W - 1] == 1) + (mid[right] == 1) +
+            (down[W - 1] == 1) + (down[W] == 1) + (down[right] == 1);
+        out[W] = CellT(lifeRule(mid[W], n));
+        changed |= (out[W] != mid[W]);
+    }
+
+    return changed != 0;
+}
+
+
+// RUNTIME DISPATCH
+template <typename CellT, typename BoundaryPolicy>
+inline bool evolveLifeFixedSize(const CellT *world, CellT *worldNew, int nx, int ny, bool &changed) {
+    /* run the specialised grid matching nx x ny, return false if there is none (use the dynamic code then) */
+
+    if (nx != ny) return false;
+
+    switch (nx) {
+    case 128:
+        changed = CAGrid<CellT, 128, 128, BoundaryPolicy>::evolveLife(world, worldNew);
+        return true;
+    case 256:
+        changed = CAGrid<CellT, 256, 256, BoundaryPolicy>::evolveLife(world, worldNew);
+        return true;
+    case 512:
+        changed = CAGrid<CellT, 512, 512, BoundaryPolicy>::evolveLife(world, worldNew);
+        return true;
+    case 1024:
+        changed = CAGrid<CellT, 1024, 1024, BoundaryPolicy>::evolveLife(world, worldNew);
+        return true;
+    case 4096:
+        changed = CAGrid<CellT, 4096, 4096, BoundaryPolicy>::evolveLife(world, worldNew);
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+#endif // CAGRID_H
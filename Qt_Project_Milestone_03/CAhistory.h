@@ -0,0 +1,319 @@
+#ifndef CAHISTORY_H
+#define CAHISTORY_H
+
+#include <string.h>
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <QtGlobal>
+#include "CAbase.h"
+#include "CAsparse.h"
+
+class CAhistory {
+    /* bounded rewind buffer of copy-on-write snapshots
+     *
+     * A snapshot cuts the planes of a CAbase into blocks of blockCells cells. Blocks that
+     * are equal to the block at the same place in the previous snapshot are shared by
+     * reference, so every generation only stores the blocks it changed. Unbounded Life
+     * snapshots share CAsparse tiles the same way. The oldest snapshots are dropped once
+     * maxSnapshots or maxBytes is exceeded.
+     */
+
+public:
+    static const int blockCells = 1024;
+
+    CAhistory(int snapshots = 1000, qint64 bytes = qint64(256) << 20) :
+        maxSnapshots(snapshots),
+        maxBytes(bytes),
+        storedBytes(0)
+        {}
+
+    int size() const {
+        return int(history.size());
+    }
+
+    bool isEmpty() const {
+        return history.empty();
+    }
+
+    qint64 getBytes() const {
+        // bytes held by the blocks and tiles of all snapshots, shared ones counted once
+        return storedBytes;
+    }
+
+    unsigned int getGeneration(int i) const {
+        return history[i].generation;
+    }
+
+    void clear();
+
+    void truncate(int n);
+
+    void record(const CAbase &ca);
+
+    void record(const CAsparse &ca);
+
+    void restore(int i, CAbase &ca) const;
+
+    void restore(int i, CAsparse &ca) const;
+
+
+private:
+    struct block {
+        int cells[blockCells];
+    };
+
+    struct sparseTile {
+        unsigned char cells[CAsparse::tileSize * CAsparse::tileSize];
+        int population;
+    };
+
+    typedef std::shared_ptr<const block> blockRef;
+    typedef std::shared_ptr<const sparseTile> tileRef;
+
+    struct snapshot {
+        // dense universe (CAbase)
+        int nx;
+        int ny;
+        std::vector<blockRef> world;
+        std::vector<blockRef> lifetime;
+        CAbase::direction directionSnake;
+        CAbase::position positionSnakeHead;
+        CAbase::position positionFood;
+        int snakeLength;
+        int snakeAction;
+        unsigned int randomSeed;
+        uint64_t randomState;
+
+        // unbounded universe (CAsparse), sorted by tile key
+        std::vector<std::pair<quint64, tileRef> > tiles;
+
+        unsigned int generation;
+        bool nochanges;
+        qint64 ownBytes; // bytes of the blocks and tiles first stored by this snapshot
+    };
+
+    void recordPlane(const int *plane, int cellCount, const std::vector<blockRef> *previous,
+                     std::vector<blockRef> &blocks, qint64 &ownBytes);
+
+    static void restorePlane(const std::vector<blockRef> &blocks, int cellCount, int *plane);
+
+    void push(snapshot &s);
+
+    void dropOldest();
+
+    std::deque<snapshot> history;
+    int maxSnapshots;
+    qint64 maxBytes;
+    qint64 storedBytes;
+};
+
+
+inline void CAhistory::clear() {
+    history.clear();
+    storedBytes = 0;
+}
+
+
+inline void CAhistory::truncate(int n) {
+    /* forget snapshots n, n + 1, ... (the future after rewinding to n - 1) */
+
+    while (int(history.size()) > qMax(n, 0)) {
+        storedBytes -= history.back().ownBytes;
+        history.pop_back();
+    }
+}
+
+
+inline void CAhistory::recordPlane(const int *plane, int cellCount, const std::vector<blockRef> *previous,
+                                   std::vector<blockRef> &blocks, qint64 &ownBytes) {
+    /* share every block equal to the previous snapshot's, copy the others */
+
+    int blockCount = (cellCount + blockCells - 1) / blockCells;
+    blocks.resize(blockCount);
+
+    for (int b = 0; b < blockCount; b++) {
+        const int *cells = plane + b * blockCells;
+        int n = (cellCount - b * blockCells < blockCells) ? cellCount - b * blockCells : blockCells;
+
+        if (previous && memcmp((*previous)[b]->cells, cells, n * sizeof(int)) == 0) {
+            blocks[b] = (*previous)[b];
+            continue;
+        }
+
+        std::shared_ptr<block> copy = std::make_shared<block>();
+        memcpy(copy->cells, cells, n * sizeof(int));
+        memset(copy->cells + n, 0, (blockCells - n) * sizeof(int));
+        blocks[b] = copy;
+        ownBytes += sizeof(block);
+    }
+}
+
+
+inline void CAhistory::restorePlane(const std::vector<blockRef> &blocks, int cellCount, int *plane) {
+    for (size_t b = 0; b < blocks.size(); b++) {
+        int n = (cellCount - int(b) * blockCells < blockCells) ? cellCount - int(b) * blockCells : blockCells;
+        memcpy(plane + b * blockCells, blocks[b]->cells, n * sizeof(int));
+    }
+}
+
+
+inline void CAhistory::record(const CAbase &ca) {
+    /* append a snapshot of a dense universe */
+
+    CA_TRACE_SCOPE("CAhistory", "recordDense");
+
+    snapshot s;
+    s.nx = ca.Nx;
+    s.ny = ca.Ny;
+    s.ownBytes = 0;
+
+    const snapshot *previous = 0;
+    if (!history.empty() && history.back().nx == s.nx && history.back().ny == s.ny &&
+            !history.back().world.empty()) {
+        previous = &history.back();
+    }
+
+    int cellCount = (ca.Ny + 2) * (ca.Nx + 2) + 1;
+    recordPlane(ca.world.get(), cellCount, previous ? &previous->world : 0, s.world, s.ownBytes);
+    recordPlane(ca.worldLifetime.get(), cellCount, previous ? &previous->lifetime : 0, s.lifetime, s.ownBytes);
+
+    s.directionSnake = ca.directionSnake;
+    s.positionSnakeHead = ca.positionSnakeHead;
+    s.positionFood = ca.positionFood;
+    s.snakeLength = ca.snakeLength;
+    s.snakeAction = ca.snakeAction;
+    s.randomSeed = ca.randomSeed;
+    s.randomState = ca.randomState;
+    s.generation = ca.generation;
+    s.nochanges = ca.nochanges;
+
+    push(s);
+}
+
+
+inline void CAhistory::record(const CAsparse &ca) {
+    /* append a snapshot of the unbounded plane */
+
+    CA_TRACE_SCOPE("CAhistory", "recordSparse");
+
+    snapshot s;
+    s.nx = s.ny = 0;
+    s.ownBytes = 0;
+    s.generation = ca.generation;
+    s.nochanges = ca.nochanges;
+
+    const std::vector<std::pair<quint64, tileRef> > *previous = history.empty() ? 0 : &history.back().tiles;
+
+    s.tiles.reserve(ca.tiles.size());
+    for (auto &entry : ca.tiles) {
+        const CAsparse::tile *t = entry.second;
+
+        if (previous) {
+            auto it = std::lower_bound(previous->begin(), previous->end(), entry.first,
+                                       [](const std::pair<quint64, tileRef> &p, quint64 key) { return p.first < key; });
+            if (it != previous->end() && it->first == entry.first && it->second->population == t->population &&
+                    memcmp(it->second->cells, t->cells, sizeof(t->cells)) == 0) {
+                s.tiles.push_back(*it);
+                continue;
+            }
+        }
+
+        std::shared_ptr<sparseTile> copy = std::make_shared<sparseTile>();
+        memcpy(copy->cells, t->cells, sizeof(t->cells));
+        copy->population = t->population;
+        s.tiles.push_back(std::make_pair(entry.first, tileRef(copy)));
+        s.ownBytes += sizeof(sparseTile);
+    }
+    std::sort(s.tiles.begin(), s.tiles.end(),
+              [](const std::pair<quint64, tileRef> &a, const std::pair<quint64, tileRef> &b) { return a.first < b.first; });
+
+    push(s);
+}
+
+
+inline void CAhistory::push(snapshot &s) {
+    storedBytes += s.ownBytes;
+    history.push_back(std::move(s));
+
+    while (history.size() > 1 && (int(history.size()) > maxSnapshots || storedBytes > maxBytes)) {
+        dropOldest();
+    }
+}
+
+
+inline void CAhistory::dropOldest() {
+    /* the blocks the oldest snapshot shares with the next one now belong to that one */
+
+    snapshot &oldest = history[0];
+    snapshot &next = history[1];
+    qint64 handedOver = 0;
+
+    if (oldest.nx == next.nx && oldest.ny == next.ny && oldest.world.size() == next.world.size()) {
+        for (size_t b = 0; b < next.world.size(); b++) {
+            if (next.world[b] == oldest.world[b]) handedOver += sizeof(block);
+            if (next.lifetime[b] == oldest.lifetime[b]) handedOver += sizeof(block);
+        }
+    }
+    size_t j = 0;
+    for (size_t i = 0; i < next.tiles.size(); i++) {
+        while (j < oldest.tiles.size() && oldest.tiles[j].first < next.tiles[i].first) j++;
+        if (j < oldest.tiles.size() && oldest.tiles[j].second == next.tiles[i].second) {
+            handedOver += sizeof(sparseTile);
+        }
+    }
+
+    next.ownBytes += handedOver;
+    storedBytes -= oldest.ownBytes - handedOver;
+    history.pop_front();
+}
+
+
+inline void CAhistory::restore(int i, CAbase &ca) const {
+    /* put snapshot i back into a dense universe, resizing it if needed */
+
+    const snapshot &s = history[i];
+    if (ca.Nx != s.nx || ca.Ny != s.ny) {
+        ca.resetWorldSize(s.nx, s.ny);
+    }
+
+    int cellCount = (s.ny + 2) * (s.nx + 2) + 1;
+    restorePlane(s.world, cellCount, ca.world.get());
+    restorePlane(s.lifetime, cellCount, ca.worldLifetime.get());
+    // the evolution planes hold a copy of the current universe right after every step
+    memcpy(ca.worldNew.get(), ca.world.get(), cellCount * sizeof(int));
+    memcpy(ca.worldLifetimeNew.get(), ca.worldLifetime.get(), cellCount * sizeof(int));
+    ca.agentsValid = false;
+
+    ca.directionSnake = s.directionSnake;
+    ca.positionSnakeHead = s.positionSnakeHead;
+    ca.positionFood = s.positionFood;
+    ca.snakeLength = s.snakeLength;
+    ca.snakeAction = s.snakeAction;
+    ca.randomSeed = s.randomSeed;
+    ca.randomState = s.randomState;
+    ca.generation = s.generation;
+    ca.nochanges = s.nochanges;
+}
+
+
+inline void CAhistory::restore(int i, CAsparse &ca) const {
+    /* put snapshot i back into the unbounded plane */
+
+    const snapshot &s = history[i];
+    ca.clear();
+    for (size_t k = 0; k < s.tiles.size(); k++) {
+        CAsparse::tile *t = ca.newTile();
+        memcpy(t->cells, s.tiles[k].second->cells, sizeof(t->cells));
+        t->population = s.tiles[k].second->population;
+        ca.population += t->population;
+        ca.tiles.insert(std::make_pair(s.tiles[k].first, t));
+    }
+    ca.generation = s.generation;
+    ca.nochanges = s.nochanges;
+}
+
+
+#endif // CAHISTORY_H
@@ -0,0 +1,368 @@
+#ifndef CASPARSE_H
+#define CASPARSE_H
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <QtGlobal>
+#include "tracerecorder.h"
+
+class CAsparse {
+    friend class CAhistory;
+    /* unbounded Game of Life plane
+     *
+     * Only non-empty tileSize x tileSize tiles are stored, keyed by their tile coordinate.
+     * Neighbouring tiles are allocated on demand when live cells reach a tile edge and
+     * tiles that go empty are returned to a pool, so memory and step time scale with
+     * the live area instead of a bounding box.
+     */
+
+public:
+    static const int tileSize = 64;
+
+    CAsparse() :
+        nochanges(false),
+        population(0),
+        generation(0)
+        {}
+
+    ~CAsparse() {
+        clear();
+        for (size_t i = 0; i < freeTiles.size(); i++) {
+            delete freeTiles[i];
+        }
+    }
+
+    // the tiles are owned by the instance
+    CAsparse(const CAsparse &) = delete;
+    CAsparse &operator=(const CAsparse &) = delete;
+
+    int getValue(int x, int y) const {
+        // get value of cell x, y (0 for cells of unallocated tiles)
+        auto it = tiles.find(tileKey(tileCoord(x), tileCoord(y)));
+        if (it == tiles.end()) return 0;
+        return it->second->cells[cellCoord(y) * tileSize + cellCoord(x)];
+    }
+
+    void setValue(int x, int y, int i);
+
+    bool isNotChanged() const {
+        return nochanges;
+    }
+
+    int getTileCount() const {
+        return int(tiles.size());
+    }
+
+    qint64 getBytes() const {
+        // live tiles and the pooled ones
+        return qint64(tiles.size() + freeTiles.size()) * qint64(sizeof(tile));
+    }
+
+    qint64 getPopulation() const {
+        return population;
+    }
+
+    unsigned int getGeneration() const {
+        return generation;
+    }
+
+    void clear();
+
+    // living cells outside the rectangle x0..x1, y0..y1
+    qint64 countOutside(int x0, int y0, int x1, int y1) const;
+
+    template <typename F>
+    void forEachCell(F f) const;
+
+    // GAME OF LIFE
+    void worldEvolutionLife();
+
+
+private:
+    struct tile {
+        unsigned char cells[tileSize * tileSize];
+        int population;
+    };
+
+    static int tileCoord(int c) {
+        // arithmetic shift rounds towards minus infinity, so negative coordinates map correctly
+        return c >> 6;
+    }
+
+    static int cellCoord(int c) {
+        return c & (tileSize - 1);
+    }
+
+    static quint64 tileKey(int tx, int ty) {
+        return (quint64(quint32(tx)) << 32) | quint64(quint32(ty));
+    }
+
+    static int keyX(quint64 key) {
+        return int(quint32(key >> 32));
+    }
+
+    static int keyY(quint64 key) {
+        return int(quint32(key & 0xffffffffu));
+    }
+
+    tile *newTile();
+
+    void releaseTile(tile *t);
+
+    const tile *findTile(int tx, int ty) const {
+        auto it = tiles.find(tileKey(tx, ty));
+        return (it == tiles.end()) ? 0 : it->second;
+    }
+
+    void gatherPadded(int tx, int ty);
+
+    std::unordered_map<quint64, tile*> tiles;
+    std::unordered_map<quint64, tile*> tilesNew;
+    std::vector<tile*> freeTiles;
+    std::vector<quint64> candidates;
+    unsigned char padded[(tileSize + 2) * (tileSize + 2)];
+    bool nochanges;
+    qint64 population;
+    unsigned int generation;
+};
+
+
+inline CAsparse::tile *CAsparse::newTile() {
+    /* take a zeroed tile from the pool or allocate a fresh one */
+
+    tile *t;
+    if (freeTiles.empty()) {
+        t = new tile;
+    } else {
+        t = freeTiles.back();
+        freeTiles.pop_back();
+    }
+    memset(t->cells, 0, sizeof(t->cells));
+    t->population = 0;
+    return t;
+}
+
+
+inline void CAsparse::releaseTile(tile *t) {
+    freeTiles.push_back(t);
+}
+
+
+inline void CAsparse::setValue(int x, int y, int i) {
+    /* set cell x, y alive (i == 1) or dead (otherwise), allocating or freeing its tile */
+
+    quint64 key = tileKey(tileCoord(x), tileCoord(y));
+    unsigned char v = (i == 1) ? 1 : 0;
+    auto it = tiles.find(key);
+
+    if (it == tiles.end()) {
+        if (!v) return;
+        it = tiles.insert(std::make_pair(key, newTile())).first;
+    }
+
+    tile *t = it->second;
+    unsigned char &cell = t->cells[cellCoord(y) * tileSize + cellCoord(x)];
+    if (cell == v) return;
+
+    cell = v;
+    t->population += v ? 1 : -1;
+    population += v ? 1 : -1;
+    nochanges = false;
+
+    if (t->population == 0) {
+        releaseTile(t);
+        tiles.erase(it);
+    }
+}
+
+
+inline void CAsparse::clear() {
+    /* drop all tiles (they are kept in the pool for reuse) */
+
+    for (auto &entry : tiles) {
+        releaseTile(entry.second);
+    }
+    tiles.clear();
+    population = 0;
+    generation = 0;
+    nochanges = false;
+}
+
+
+inline qint64 CAsparse::countOutside(int x0, int y0, int x1, int y1) const {
+    /* whole tiles by their population, only tiles cut by the border cell by cell */
+
+    qint64 outside = 0;
+    for (auto &entry : tiles) {
+        int tx0 = keyX(entry.first) * tileSize;
+        int ty0 = keyY(entry.first) * tileSize;
+        int tx1 = tx0 + tileSize - 1;
+        int ty1 = ty0 + tileSize - 1;
+        if (tx0 >= x0 && tx1 <= x1 && ty0 >= y0 && ty1 <= y1) continue;
+        if (tx1 < x0 || tx0 > x1 || ty1 < y0 || ty0 > y1) {
+            outside += entry.second->population;
+            continue;
+        }
+        const unsigned char *cells = entry.second->cells;
+        for (int y = 0; y < tileSize; y++) {
+            for (int x = 0; x < tileSize; x++) {
+                if (cells[y * tileSize + x] &&
+                        (tx0 + x < x0 || tx0 + x > x1 || ty0 + y < y0 || ty0 + y > y1)) outside++;
+            }
+        }
+    }
+    return outside;
+}
+
+
+template <typename F>
+inline void CAsparse::forEachCell(F f) const {
+    /* call f(x, y) for every living cell, tile by tile */
+
+    for (auto &entry : tiles) {
+        int x0 = keyX(entry.first) * tileSize;
+        int y0 = keyY(entry.first) * tileSize;
+        const unsigned char *cells = entry.second->cells;
+        for (int y = 0; y < tileSize; y++) {
+            for (int x = 0; x < tileSize; x++) {
+                if (cells[y * tileSize + x]) f(x0 + x, y0 + y);
+            }
+        }
+    }
+}
+
+
+inline void CAsparse::gatherPadded(int tx, int ty) {
+    /* copy tile tx, ty and a one cell wide ring of its eight neighbours into the padded buffer */
+
+    const int stride = tileSize + 2;
+    memset(padded, 0, sizeof(padded));
+
+    const tile *c = findTile(tx, ty);
+    if (c) {
+        for (int y = 0; y < tileSize; y++) {
+            memcpy(padded + (y + 1) * stride + 1, c->cells + y * tileSize, tileSize);
+        }
+    }
+
+    const tile *n = findTile(tx, ty - 1); // up
+    if (n) memcpy(padded + 1, n->cells + (tileSize - 1) * tileSize, tileSize);
+    const tile *s = findTile(tx, ty + 1); // down
+    if (s) memcpy(padded + (tileSize + 1) * stride + 1, s->cells, tileSize);
+
+    const tile *w = findTile(tx - 1, ty); // left
+    if (w) {
+        for (int y = 0; y < tileSize; y++) {
+            padded[(y + 1) * stride] = w->cells[y * tileSize + tileSize - 1];
+        }
+    }
+    const tile *e = findTile(tx + 1, ty); // right
+    if (e) {
+        for (int y = 0; y < tileSize; y++) {
+            padded[(y + 1) * stride + tileSize + 1] = e->cells[y * tileSize];
+        }
+    }
+
+    // corners
+    const tile *nw = findTile(tx - 1, ty - 1);
+    if (nw) padded[0] = nw->cells[tileSize * tileSize - 1];
+    const tile *ne = findTile(tx + 1, ty - 1);
+    if (ne) padded[tileSize + 1] = ne->cells[(tileSize - 1) * tileSize];
+    const tile *sw = findTile(tx - 1, ty + 1);
+    if (sw) padded[(tileSize + 1) * stride] = sw->cells[tileSize - 1];
+    const tile *se = findTile(tx + 1, ty + 1);
+    if (se) padded[(tileSize + 1) * stride + tileSize + 1] = se->cells[0];
+}
+
+
+// GAME OF LIFE
+inline void CAsparse::worldEvolutionLife() {
+    /* apply the Game of Life rules (see CAbase::cellEvolutionLife) on the unbounded plane */
+
+    CA_TRACE_SCOPE("CAsparse", "worldEvolutionLife");
+
+    const int stride = tileSize + 2;
+
+    // candidate tiles: every live tile plus each neighbour its edge cells can give birth in
+    candidates.clear();
+    for (auto &entry : tiles) {
+        int tx = keyX(entry.first);
+        int ty = keyY(entry.first);
+        const unsigned char *cells = entry.second->cells;
+        candidates.push_back(entry.first);
+
+        bool top(false), bottom(false), left(false), right(false);
+        for (int i = 0; i < tileSize; i++) {
+            top |= cells[i] != 0;
+            bottom |= cells[(tileSize - 1) * tileSize + i] != 0;
+            left |= cells[i * tileSize] != 0;
+            right |= cells[i * tileSize + tileSize - 1] != 0;
+        }
+
+        if (top) candidates.push_back(tileKey(tx, ty - 1));
+        if (bottom) candidates.push_back(tileKey(tx, ty + 1));
+        if (left) candidates.push_back(tileKey(tx - 1, ty));
+        if (right) candidates.push_back(tileKey(tx + 1, ty));
+        if (cells[0]) candidates.push_back(tileKey(tx - 1, ty - 1));
+        if (cells[tileSize - 1]) candidates.push_back(tileKey(tx + 1, ty - 1));
+        if (cells[(tileSize - 1) * tileSize]) candidates.push_back(tileKey(tx - 1, ty + 1));
+        if (cells[tileSize * tileSize - 1]) candidates.push_back(tileKey(tx + 1, ty + 1));
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    nochanges = true;
+    population = 0;
+    tilesNew.clear();
+
+    for (size_t c = 0; c < candidates.size(); c++) {
+        int tx = keyX(candidates[c]);
+        int ty = keyY(candidates[c]);
+        gatherPadded(tx, ty);
+
+        tile *t = newTile();
+        int sum = 0;
+        for (int y = 0; y < tileSize; y++) {
+            const unsigned char *up = padded + y * stride;
+            const unsigned char *mid = up + stride;
+            const unsigned char *down = mid + stride;
+            unsigned char *out = t->cells + y * tileSize;
+            for (int x = 0; x < tileSize; x++) {
+                int n = up[x] + up[x + 1] + up[x + 2] +
+                        mid[x] + mid[x + 2] +
+                        down[x] + down[x + 1] + down[x + 2];
+                unsigned char v = (n == 3) | (mid[x + 1] & (n == 2));
+                out[x] = v;
+                sum += v;
+            }
+        }
+        t->population = sum;
+
+        const tile *old = findTile(tx, ty);
+        if (old == 0) {
+            if (sum != 0) nochanges = false;
+        } else if (old->population != sum || memcmp(old->cells, t->cells, sizeof(t->cells)) != 0) {
+            nochanges = false;
+        }
+
+        if (sum == 0) {
+            releaseTile(t);
+        } else {
+            tilesNew.insert(std::make_pair(candidates[c], t));
+            population += sum;
+        }
+    }
+
+    // recycle the previous generation and swap in the new one
+    for (auto &entry : tiles) {
+        releaseTile(entry.second);
+    }
+    tiles.swap(tilesNew);
+    tilesNew.clear();
+    generation++;
+}
+
+
+#endif // CASPARSE_H
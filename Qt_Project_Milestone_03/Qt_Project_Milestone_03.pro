@@ -4,12 +4,19 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = Qt_Project_Milestone_03
 TEMPLATE = app
+CONFIG += c++14
+
+# per-stage timing for the performance overlay, "qmake CONFIG+=noperf" compiles it out
+!noperf: DEFINES += CA_PERF
+
+# timeline recording (Chrome Trace Event JSON), "qmake CONFIG+=notrace" compiles it out
+!notrace: DEFINES += CA_TRACE
 
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which has been marked as deprecated (the exact warnings
@@ -27,13 +34,58 @@ SOURCES += \
         main.cpp \
         mainwindow.cpp \
         gamewidget.cpp \
-        keypressfilter.cpp
+        keypressfilter.cpp \
+        workstealingpool.cpp \
+        ensemblerunner.cpp \
+        soupcensus.cpp \
+        clusterlabeler.cpp \
+        stripcluster.cpp \
+        framepublisher.cpp \
+        controlserver.cpp \
+        metricsregistry.cpp \
+        metricsexporter.cpp \
+        frameexporter.cpp \
+        gifencoder.cpp \
+        gamefile.cpp \
+        headless.cpp \
+        snakeautopilot.cpp \
+        snakeselfplay.cpp \
+        perfstats.cpp \
+        tracerecorder.cpp \
+        caframereader.c
 
 HEADERS += \
         mainwindow.h \
         gamewidget.h \
         CAbase.h \
-        keypressfilter.h
+        CAsparse.h \
+        CAhistory.h \
+        CAgrid.h \
+        keypressfilter.h \
+        workstealingpool.h \
+        ensemblerunner.h \
+        soupcensus.h \
+        clusterlabeler.h \
+        stripcluster.h \
+        framepublisher.h \
+        controlserver.h \
+        localserver.h \
+        metricsregistry.h \
+        metricsexporter.h \
+        frameexporter.h \
+        gifencoder.h \
+        gamefile.h \
+        caframe.h \
+        caframereader.h \
+        headless.h \
+        snakeautopilot.h \
+        snakeinput.h \
+        snakeselfplay.h \
+        perfstats.h \
+        tracerecorder.h
+
+# worker processes share memory with POSIX shm, semaphores and barriers
+unix:!macx: LIBS += -lrt -lpthread
 
 FORMS += \
         mainwindow.ui
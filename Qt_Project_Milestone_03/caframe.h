@@ -0,0 +1,65 @@
+#ifndef CAFRAME_H
+#define CAFRAME_H
+
+/* layout of the shared-memory frame ring (see FramePublisher and caframereader.h)
+ *
+ * The region starts with a ca_frame_header, followed by `slots` slots of `slot_bytes`
+ * bytes each. A slot is a ca_frame_slot followed by two packed planes of max_cells
+ * cells: the states (world) and the lifetimes, row by row without the halo, int16 each.
+ * Frames are numbered from 1 and frame f goes into slot f % slots. The writer stores
+ * the magic last (release), so a reader that loads it (acquire) sees a complete header.
+ *
+ * Every slot is a seqlock: the writer makes seq odd, writes the slot and makes seq even
+ * again, then stores the frame number in header.published. A reader takes a slot's even
+ * seq, reads, and keeps the data only if seq has not changed in the meantime.
+ *
+ * Plain C so that external tools can use it; the counters are accessed with the GCC /
+ * Clang __atomic builtins on both sides.
+ */
+
+#include <stdint.h>
+
+#define CA_FRAME_MAGIC 0x31524643u /* "CFR1" */
+#define CA_FRAME_VERSION 1
+#define CA_FRAME_DEFAULT_NAME "/ca-frames"
+
+struct ca_frame_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;      /* number of frame slots */
+    uint32_t slot_bytes; /* distance between two slots */
+    uint32_t max_cells;  /* cells per plane a slot can hold */
+    uint32_t reserved;
+    uint64_t published;  /* number of the newest complete frame, 0: none yet */
+    uint8_t padding[32];
+};
+
+struct ca_frame_slot {
+    uint64_t seq;        /* odd while the writer is inside the slot */
+    uint64_t frame;      /* frame number stored in the slot */
+    uint32_t generation; /* generation counter of the board */
+    int32_t mode;        /* 0 life, 1 snake, 2 predator-prey */
+    int32_t nx;
+    int32_t ny;
+    uint8_t padding[32];
+};
+
+static inline const struct ca_frame_slot *ca_frame_slot_at(const struct ca_frame_header *h, uint64_t frame) {
+    return (const struct ca_frame_slot *) ((const char *) h + sizeof(struct ca_frame_header) +
+                                           (size_t) (frame % h->slots) * h->slot_bytes);
+}
+
+static inline const int16_t *ca_frame_world(const struct ca_frame_slot *s) {
+    return (const int16_t *) (s + 1);
+}
+
+static inline const int16_t *ca_frame_lifetime(const struct ca_frame_slot *s, uint32_t max_cells) {
+    return (const int16_t *) (s + 1) + max_cells;
+}
+
+static inline uint32_t ca_frame_slot_bytes(uint32_t max_cells) {
+    /* slot header and both planes, rounded up to a cache line */
+    return (uint32_t) ((sizeof(struct ca_frame_slot) + 2 * sizeof(int16_t) * (size_t) max_cells + 63) & ~(size_t) 63);
+}
+
+#endif /* CAFRAME_H */
@@ -0,0 +1,120 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "caframereader.h"
+
+
+struct ca_frame_reader {
+    const struct ca_frame_header *header;
+    size_t bytes;
+};
+
+
+ca_frame_reader *ca_frame_reader_open(const char *name) {
+    struct stat info;
+    void *region;
+    const struct ca_frame_header *h;
+    ca_frame_reader *reader;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(struct ca_frame_header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    region = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) return NULL;
+
+    /* the name exists before the header is written; the writer stores the magic last */
+    h = (const struct ca_frame_header *) region;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != CA_FRAME_MAGIC || h->version != CA_FRAME_VERSION || h->slots == 0 ||
+            sizeof(struct ca_frame_header) + (size_t) h->slots * h->slot_bytes > (size_t) info.st_size) {
+        munmap(region, (size_t) info.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    reader = (ca_frame_reader *) malloc(sizeof(ca_frame_reader));
+    if (!reader) {
+        munmap(region, (size_t) info.st_size);
+        return NULL;
+    }
+    reader->header = h;
+    reader->bytes = (size_t) info.st_size;
+    return reader;
+}
+
+
+void ca_frame_reader_close(ca_frame_reader *reader) {
+    if (!reader) return;
+    munmap((void *) reader->header, reader->bytes);
+    free(reader);
+}
+
+
+uint64_t ca_frame_reader_published(const ca_frame_reader *reader) {
+    return __atomic_load_n(&reader->header->published, __ATOMIC_ACQUIRE);
+}
+
+
+int ca_frame_reader_latest(const ca_frame_reader *reader, ca_frame_view *view) {
+    /* seqlock read of the slot of the newest frame, retried while the writer is inside it */
+
+    const struct ca_frame_header *h = reader->header;
+    for (;;) {
+        uint64_t frame = __atomic_load_n(&h->published, __ATOMIC_ACQUIRE);
+        const struct ca_frame_slot *s;
+        uint64_t seq;
+        if (frame == 0) return -1;
+
+        s = ca_frame_slot_at(h, frame);
+        seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+
+        view->frame = s->frame;
+        view->generation = s->generation;
+        view->mode = s->mode;
+        view->nx = s->nx;
+        view->ny = s->ny;
+        view->world = ca_frame_world(s);
+        view->lifetime = ca_frame_lifetime(s, h->max_cells);
+        view->slot = s;
+        view->seq = seq;
+
+        /* a newer frame may already have taken the slot over */
+        if (view->frame == frame && ca_frame_view_valid(view)) return 0;
+    }
+}
+
+
+int ca_frame_view_valid(const ca_frame_view *view) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&view->slot->seq, __ATOMIC_RELAXED) == view->seq;
+}
+
+
+int ca_frame_reader_copy(const ca_frame_reader *reader, ca_frame_view *view,
+                         int16_t *world, int16_t *lifetime, size_t capacity) {
+    for (;;) {
+        size_t cells;
+        if (ca_frame_reader_latest(reader, view) != 0) return -1;
+
+        cells = (size_t) view->nx * (size_t) view->ny;
+        if (cells > capacity) return -1;
+        if (world) memcpy(world, view->world, cells * sizeof(int16_t));
+        if (lifetime) memcpy(lifetime, view->lifetime, cells * sizeof(int16_t));
+
+        if (ca_frame_view_valid(view)) {
+            if (world) view->world = world;
+            if (lifetime) view->lifetime = lifetime;
+            return 0;
+        }
+    }
+}
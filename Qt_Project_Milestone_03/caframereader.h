@@ -0,0 +1,68 @@
+#ifndef CAFRAMEREADER_H
+#define CAFRAMEREADER_H
+
+/* C reader of the shared-memory frame ring published by the simulator
+ *
+ *     ca_frame_reader *r = ca_frame_reader_open(CA_FRAME_DEFAULT_NAME);
+ *     ca_frame_view v;
+ *     if (r && ca_frame_reader_latest(r, &v) == 0) {
+ *         ... read v.world[y * v.nx + x] ...
+ *         if (!ca_frame_view_valid(&v)) ... the writer reused the slot, the data read is torn
+ *     }
+ *     ca_frame_reader_close(r);
+ *
+ * ca_frame_reader_latest gives pointers into the shared memory (no copy); they stay
+ * valid for slots - 1 more frames of the writer. ca_frame_reader_copy copies the newest
+ * frame and retries until the copy is consistent. The reader never writes to the region,
+ * so any number of readers can poll at any rate without slowing the writer down.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "caframe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ca_frame_reader ca_frame_reader;
+
+typedef struct ca_frame_view {
+    uint64_t frame;
+    uint32_t generation;
+    int32_t mode;
+    int32_t nx;
+    int32_t ny;
+    const int16_t *world;    /* nx * ny states, row by row */
+    const int16_t *lifetime; /* nx * ny lifetimes */
+
+    /* private: the slot and its seqlock counter when the view was taken */
+    const struct ca_frame_slot *slot;
+    uint64_t seq;
+} ca_frame_view;
+
+/* map the ring of the given name read-only, NULL (and errno) on failure;
+   EINVAL also while the writer has not finished the header yet */
+ca_frame_reader *ca_frame_reader_open(const char *name);
+
+void ca_frame_reader_close(ca_frame_reader *reader);
+
+/* number of the newest published frame, 0 if there is none yet */
+uint64_t ca_frame_reader_published(const ca_frame_reader *reader);
+
+/* zero-copy view of the newest frame: 0 on success, -1 if nothing has been published */
+int ca_frame_reader_latest(const ca_frame_reader *reader, ca_frame_view *view);
+
+/* nonzero as long as the writer has not touched the slot of the view since it was taken */
+int ca_frame_view_valid(const ca_frame_view *view);
+
+/* copy the newest frame into world and lifetime (either may be NULL) of capacity cells each;
+   0 on success, -1 if nothing has been published or the frame does not fit */
+int ca_frame_reader_copy(const ca_frame_reader *reader, ca_frame_view *view,
+                         int16_t *world, int16_t *lifetime, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAFRAMEREADER_H */
@@ -0,0 +1,289 @@
+#include <climits>
+#include <algorithm>
+
+#include "clusterlabeler.h"
+
+
+ClusterLabeler::ClusterLabeler(int threads) :
+    connectivity(Eight),
+    threads(threads),
+    wrap(true),
+    nx(0),
+    ny(0),
+    world(0),
+    value(-1)
+{
+}
+
+
+int ClusterLabeler::find(int i) const {
+    /* root of cell i without touching the parent array (safe while other threads read it) */
+
+    while (parent[i] != i) i = parent[i];
+    return i;
+}
+
+
+int ClusterLabeler::unite(int a, int b) {
+    /* join the sets of a and b, the smaller index becomes the root; returns the root that
+     * was attached to the other one, -1 if they were joined already */
+
+    while (parent[a] != a) {
+        parent[a] = parent[parent[a]]; // path halving
+        a = parent[a];
+    }
+    while (parent[b] != b) {
+        parent[b] = parent[parent[b]];
+        b = parent[b];
+    }
+    if (a == b) return -1;
+    if (a < b) {
+        parent[b] = a;
+        return b;
+    }
+    parent[a] = b;
+    return a;
+}
+
+
+int ClusterLabeler::labelBand(int y0, int y1) {
+    /* union-find over rows y0..y1, every union stays inside the band; returns the number of roots
+     *
+     * A new cell is linked to the first labelled neighbour it finds, so only a second,
+     * not yet connected neighbour costs a union. With eight neighbours the cell above is
+     * already joined to the cells left and right of it, and to the cell on the left.
+     */
+
+    const int stride = nx + 2;
+    int roots = 0;
+    for (int y = y0; y <= y1; y++) {
+        const int row = y * stride;
+        const int up = row - stride;
+        const bool hasUp = y > y0;
+        // the halo columns are no cells (the vector may hold them from a larger universe)
+        parent[row] = parent[row + nx + 1] = -1;
+        for (int x = 1; x <= nx; x++) {
+            int i = row + x;
+            int v = world[i];
+            if (value < 0 ? v <= 0 : v != value) {
+                parent[i] = -1;
+                continue;
+            }
+
+            int left = (x > 1 && parent[i - 1] >= 0) ? i - 1 : -1;
+            if (hasUp && parent[up + x] >= 0) {
+                parent[i] = parent[up + x];
+                if (connectivity == Four && left >= 0 && unite(i - 1, up + x) >= 0) roots--;
+                continue;
+            }
+
+            int link = left;
+            if (hasUp && connectivity == Eight) {
+                int upLeft = (x > 1) ? up + x - 1 : (wrap ? up + nx : -1);
+                int upRight = (x < nx) ? up + x + 1 : (wrap ? up + 1 : -1);
+                if (upLeft >= 0 && parent[upLeft] >= 0) {
+                    if (link >= 0) {
+                        if (unite(link, upLeft) >= 0) roots--;
+                    } else {
+                        link = upLeft;
+                    }
+                }
+                if (upRight >= 0 && parent[upRight] >= 0) {
+                    if (link >= 0) {
+                        if (unite(link, upRight) >= 0) roots--;
+                    } else {
+                        link = upRight;
+                    }
+                }
+            }
+
+            if (link >= 0) {
+                parent[i] = parent[link];
+            } else {
+                parent[i] = i;
+                roots++;
+            }
+        }
+        // the first and the last column are neighbours
+        if (wrap && nx > 1 && parent[row + 1] >= 0 && parent[row + nx] >= 0 && unite(row + 1, row + nx) >= 0) roots--;
+    }
+    return roots;
+}
+
+
+void ClusterLabeler::mergeRows(int ya, int yb) {
+    /* join the sets across the border between row ya and the row yb below it */
+
+    const int stride = nx + 2;
+    for (int x = 1; x <= nx; x++) {
+        int a = ya * stride + x;
+        if (parent[a] < 0) continue;
+
+        int b = yb * stride + x;
+        int neighbours[3] = {b, (x > 1) ? b - 1 : (wrap ? yb * stride + nx : -1),
+                             (x < nx) ? b + 1 : (wrap ? yb * stride + 1 : -1)};
+        for (int k = 0; k < ((connectivity == Eight) ? 3 : 1); k++) {
+            if (neighbours[k] < 0 || parent[neighbours[k]] < 0) continue;
+            int lost = unite(a, neighbours[k]);
+            if (lost >= 0) {
+                // the band of the root that was joined to another one has one root less
+                bandRoots[(lost / stride - 1) / bandRows + 1]--;
+            }
+        }
+    }
+}
+
+
+void ClusterLabeler::fitCircle(int minP, int maxP, int minS, int maxS, int n, int &start, int &length) const {
+    /* shortest of the two extents: plain coordinates, or turned by n / 2 for boxes across the edge */
+
+    int plain = maxP - minP + 1;
+    int shifted = maxS - minS + 1;
+    if (wrap && shifted < plain) {
+        start = minS - n / 2;
+        if (start < 1) start += n;
+        length = shifted;
+    } else {
+        start = minP;
+        length = plain;
+    }
+}
+
+
+void ClusterLabeler::label(const CAview &view, int v) {
+    /* label the cells with value v (every cell > 0 for v < 0), then count and measure the components */
+
+    nx = view.nx;
+    ny = view.ny;
+    world = view.world;
+    value = v;
+
+    const int stride = nx + 2;
+    const int bands = (ny + bandRows - 1) / bandRows;
+    parent.resize(size_t(stride) * (ny + 2));
+    labels.resize(parent.size());
+    std::fill(labels.begin(), labels.begin() + stride, -1);
+    std::fill(labels.end() - stride, labels.end(), -1);
+    bandRoots.assign(bands + 1, 0);
+
+    if (!pool) pool.reset(new WorkStealingPool(threads));
+    const int workers = pool->getThreadCount();
+
+    // union-find inside the bands
+    pool->run(bands, [this](int band, int) {
+        bandRoots[band + 1] = labelBand(1 + band * bandRows, std::min(ny, (band + 1) * bandRows));
+    });
+
+    // join the bands, the last row wraps around to the first one
+    for (int band = 0; band < bands; band++) {
+        int last = std::min(ny, (band + 1) * bandRows);
+        if (last < ny) {
+            mergeRows(last, last + 1);
+        } else if (wrap) {
+            mergeRows(last, 1);
+        }
+    }
+
+    // number the roots band by band
+    for (int band = 0; band < bands; band++) {
+        bandRoots[band + 1] += bandRoots[band];
+    }
+    const int count = bandRoots[bands];
+
+    pool->run(bands, [this, stride](int band, int) {
+        int id = bandRoots[band];
+        for (int i = (1 + band * bandRows) * stride; i < (1 + std::min(ny, (band + 1) * bandRows)) * stride; i++) {
+            if (parent[i] == i) labels[i] = id++;
+        }
+    });
+
+    // label every cell by its root and measure the components per worker
+    const extent empty = {0, INT_MAX, INT_MIN, INT_MAX, INT_MIN, INT_MAX, INT_MIN, INT_MAX, INT_MIN};
+    partial.resize(workers);
+    for (int w = 0; w < workers; w++) {
+        partial[w].assign(count, empty);
+    }
+
+    // the labels of the roots are read by every band and stay as numbered above
+    pool->run(bands, [this, stride](int band, int worker) {
+        std::vector<extent> &acc = partial[worker];
+        const int halfX = nx / 2;
+        const int halfY = ny / 2;
+        for (int y = 1 + band * bandRows; y <= std::min(ny, (band + 1) * bandRows); y++) {
+            int ys = (y + halfY > ny) ? y + halfY - ny : y + halfY;
+            labels[y * stride] = labels[y * stride + nx + 1] = -1;
+            for (int x = 1; x <= nx; x++) {
+                int i = y * stride + x;
+                if (parent[i] < 0) {
+                    labels[i] = -1;
+                    continue;
+                }
+
+                // a run of cells in a row is one component, measure it as a whole
+                int id = (parent[i] == i) ? labels[i] : labels[find(i)];
+                int x0 = x;
+                for (; x <= nx && parent[y * stride + x] >= 0; x++) {
+                    if (parent[y * stride + x] != y * stride + x) labels[y * stride + x] = id;
+                }
+                x--;
+
+                int xs0 = (x0 + halfX > nx) ? x0 + halfX - nx : x0 + halfX;
+                int xs1 = (x + halfX > nx) ? x + halfX - nx : x + halfX;
+                if (xs1 < xs0) {
+                    // the run is cut by the edge of the turned frame
+                    xs0 = 1;
+                    xs1 = nx;
+                }
+                extent &e = acc[id];
+                e.size += x - x0 + 1;
+                e.minX = std::min(e.minX, x0);
+                e.maxX = std::max(e.maxX, x);
+                e.minXs = std::min(e.minXs, xs0);
+                e.maxXs = std::max(e.maxXs, xs1);
+                e.minY = std::min(e.minY, y);
+                e.maxY = std::max(e.maxY, y);
+                e.minYs = std::min(e.minYs, ys);
+                e.maxYs = std::max(e.maxYs, ys);
+            }
+        }
+    });
+
+    // merge the workers' measurements
+    components.resize(count);
+    histogram.assign(1, 0);
+    for (int c = 0; c < count; c++) {
+        extent e = empty;
+        for (int w = 0; w < workers; w++) {
+            const extent &p = partial[w][c];
+            if (p.size == 0) continue;
+            e.size += p.size;
+            e.minX = std::min(e.minX, p.minX);
+            e.maxX = std::max(e.maxX, p.maxX);
+            e.minXs = std::min(e.minXs, p.minXs);
+            e.maxXs = std::max(e.maxXs, p.maxXs);
+            e.minY = std::min(e.minY, p.minY);
+            e.maxY = std::max(e.maxY, p.maxY);
+            e.minYs = std::min(e.minYs, p.minYs);
+            e.maxYs = std::max(e.maxYs, p.maxYs);
+        }
+
+        component &comp = components[c];
+        comp.size = e.size;
+        fitCircle(e.minX, e.maxX, e.minXs, e.maxXs, nx, comp.x, comp.width);
+        fitCircle(e.minY, e.maxY, e.minYs, e.maxYs, ny, comp.y, comp.height);
+
+        int k = 0;
+        while ((2 << k) <= e.size) k++;
+        if (k >= int(histogram.size())) histogram.resize(k + 1, 0);
+        histogram[k]++;
+    }
+}
+
+
+int ClusterLabeler::getLargest() const {
+    int largest = 0;
+    for (const component &c : components) {
+        largest = std::max(largest, c.size);
+    }
+    return largest;
+}
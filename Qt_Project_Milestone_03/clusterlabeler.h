@@ -0,0 +1,109 @@
+#ifndef CLUSTERLABELER_H
+#define CLUSTERLABELER_H
+
+#include <memory>
+#include <vector>
+#include "CAbase.h"
+#include "workstealingpool.h"
+
+class ClusterLabeler {
+    /* connected-component labelling of a torus universe (or of a bounded one, see setWrap)
+     *
+     * The rows are cut into bands of bandRows rows that are labelled in parallel with a
+     * union-find over cell indices (every band only touches its own part of the parent
+     * array). The borders between bands, including the wrap from the last row to the first,
+     * are merged afterwards; the wrap from the last column to the first is handled inside
+     * the bands. Two more parallel passes number the components and gather their sizes and
+     * bounding boxes with per-worker accumulators.
+     */
+
+public:
+    explicit ClusterLabeler(int threads = 0);
+
+    enum Connectivity {
+        Four = 4,
+        Eight = 8
+    };
+
+    void setConnectivity(int c) {
+        connectivity = c;
+    }
+
+    void setThreads(int n) {
+        threads = n;
+        pool.reset();
+    }
+
+    // true (default): the edges of the universe touch as on a torus, false: a bounded universe
+    void setWrap(bool on) {
+        wrap = on;
+    }
+
+    // label the cells of the given value, value < 0 labels every cell > 0
+    void label(const CAview &view, int value = -1);
+
+    struct component {
+        int size;
+        int x;      // left column, the box may wrap: x + width - 1 can be larger than nx
+        int y;      // top row, same for y + height - 1 and ny
+        int width;
+        int height;
+    };
+
+    int getCount() const {
+        return int(components.size());
+    }
+
+    const std::vector<component> &getComponents() const {
+        return components;
+    }
+
+    // histogram[k]: number of components with 2^k <= size < 2^(k + 1)
+    const std::vector<int> &getHistogram() const {
+        return histogram;
+    }
+
+    // component index of every cell (stride nx + 2 as in CAbase), -1 for other cells
+    const std::vector<int> &getLabels() const {
+        return labels;
+    }
+
+    int getLargest() const;
+
+    static const int bandRows = 64;
+
+private:
+    // bounding box on the circle: extent in the plain and in the half-turned frame
+    struct extent {
+        int size;
+        int minX, maxX, minXs, maxXs;
+        int minY, maxY, minYs, maxYs;
+    };
+
+    int find(int i) const;
+
+    int unite(int a, int b);
+
+    int labelBand(int y0, int y1);
+
+    void mergeRows(int ya, int yb);
+
+    void fitCircle(int minP, int maxP, int minS, int maxS, int n, int &start, int &length) const;
+
+    int connectivity;
+    int threads;
+    bool wrap;
+    std::unique_ptr<WorkStealingPool> pool; // kept between generations
+    int nx;
+    int ny;
+    const int *world;
+    int value;
+    std::vector<int> parent;
+    std::vector<int> labels;
+    std::vector<int> bandRoots;
+    std::vector<std::vector<extent> > partial;
+    std::vector<component> components;
+    std::vector<int> histogram;
+};
+
+#endif // CLUSTERLABELER_H
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "controlserver.h"
+#include "gamewidget.h"
+#include "localserver.h"
+
+
+static void appendUInt32(QByteArray &out, quint32 v) {
+    char bytes[4] = {char(v), char(v >> 8), char(v >> 16), char(v >> 24)};
+    out.append(bytes, 4);
+}
+
+
+static void appendInt16(QByteArray &out, qint16 v) {
+    char bytes[2] = {char(v), char(quint16(v) >> 8)};
+    out.append(bytes, 2);
+}
+
+
+static quint32 readUInt32(const char *p) {
+    const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+    return quint32(u[0]) | (quint32(u[1]) << 8) | (quint32(u[2]) << 16) | (quint32(u[3]) << 24);
+}
+
+
+static QByteArray message(int type, const QByteArray &payload) {
+    QByteArray out;
+    out.reserve(ControlServer::headerBytes + payload.size());
+    out.append(char(type));
+    appendUInt32(out, quint32(payload.size()));
+    out.append(payload);
+    return out;
+}
+
+
+ControlServer::ControlServer(GameWidget *game, QObject *parent) :
+    QObject(parent),
+    server(new QLocalServer(this)),
+    game(game)
+{
+    connect(server, SIGNAL(newConnection()), this, SLOT(acceptClients()));
+}
+
+
+ControlServer::~ControlServer() {
+    for (client *c : clients) {
+        c->socket->disconnect(this);
+        delete c;
+    }
+}
+
+
+bool ControlServer::listen(const QString &name) {
+    return listenLocal(server, name);
+}
+
+
+QString ControlServer::errorString() const {
+    return server->errorString();
+}
+
+
+ControlServer::client *ControlServer::find(QObject *socket) {
+    for (client *c : clients) {
+        if (c->socket == socket) return c;
+    }
+    return 0;
+}
+
+
+void ControlServer::acceptClients() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        client *c = new client;
+        c->socket = socket;
+        c->subscribed = false;
+        c->pending = false;
+        c->nx = c->ny = c->mode = -1;
+        clients.push_back(c);
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(sendPending()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(dropClient()));
+    }
+}
+
+
+void ControlServer::dropClient() {
+    client *c = find(sender());
+    if (!c) return;
+
+    clients.erase(std::find(clients.begin(), clients.end(), c));
+    c->socket->deleteLater();
+    delete c;
+}
+
+
+void ControlServer::readRequests() {
+    /* split the input into messages and handle the complete ones */
+
+    client *c = find(sender());
+    if (!c) return;
+
+    c->input.append(c->socket->readAll());
+    while (c->input.size() >= headerBytes) {
+        int type = quint8(c->input[0]);
+        quint32 length = readUInt32(c->input.constData() + 1);
+        if (length > quint32(maxPayloadBytes)) {
+            c->socket->abort();
+            return;
+        }
+        if (quint32(c->input.size()) < headerBytes + length) break;
+
+        QByteArray payload = c->input.mid(headerBytes, int(length));
+        c->input.remove(0, headerBytes + int(length));
+
+        QByteArray ack;
+        ack.append(char(type));
+        ack.append(char(handle(*c, type, payload) ? 0 : 1));
+        c->socket->write(message(Ack, ack));
+    }
+}
+
+
+bool ControlServer::handle(client &c, int type, const QByteArray &payload) {
+    /* run one request, false if it is unknown or malformed */
+
+    const char *p = payload.constData();
+    switch (type) {
+    case Start:
+        if (payload.size() != 4) return false;
+        emit startRequested(int(readUInt32(p)));
+        return true;
+    case Stop:
+        emit stopRequested();
+        return true;
+    case Clear:
+        emit clearRequested();
+        return true;
+    case SetInterval:
+        if (payload.size() != 4 || int(readUInt32(p)) <= 0) return false;
+        emit intervalRequested(int(readUInt32(p)));
+        return true;
+    case SetMode:
+        if (payload.size() != 4 || readUInt32(p) > 3) return false;
+        emit modeRequested(int(readUInt32(p)));
+        return true;
+    case SetCells: {
+        if (payload.size() < 4) return false;
+        quint32 n = readUInt32(p);
+        if (quint32(payload.size()) != 4 + 12 * quint64(n)) return false;
+        bool ok = true;
+        for (quint32 i = 0; i < n; i++) {
+            const char *cell = p + 4 + 12 * i;
+            ok &= game->setCell(int(readUInt32(cell)), int(readUInt32(cell + 4)), int(readUInt32(cell + 8)));
+        }
+        publishFrame();
+        return ok;
+    }
+    case Subscribe:
+        c.subscribed = true;
+        c.sent.clear();
+        c.nx = c.ny = c.mode = -1;
+        sendFrame(c);
+        return true;
+    case Unsubscribe:
+        c.subscribed = false;
+        c.pending = false;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+void ControlServer::publishFrame() {
+    CA_TRACE_SCOPE("ControlServer", "publishFrame");
+
+    for (client *c : clients) {
+        if (!c->subscribed) continue;
+        if (c->socket->bytesToWrite() > maxPendingBytes) {
+            // slow subscriber: skip this frame, it gets a delta to the newest one later
+            c->pending = true;
+            continue;
+        }
+        sendFrame(*c);
+    }
+}
+
+
+void ControlServer::sendPending() {
+    client *c = find(sender());
+    if (c && c->pending && c->socket->bytesToWrite() <= maxPendingBytes) {
+        sendFrame(*c);
+    }
+}
+
+
+void ControlServer::sendFrame(client &c) {
+    /* a delta to the last frame the client got, or a key frame if there is none or the delta is larger */
+
+    c.pending = false;
+    int mode = game->getUniverseMode();
+    if (mode == 3) return; // unbounded life has no dense frame
+
+    CAview view = game->getView();
+    const int cells = view.nx * view.ny;
+    QByteArray payload;
+    appendUInt32(payload, view.generation);
+
+    if (view.nx == c.nx && view.ny == c.ny && mode == c.mode) {
+        QByteArray changes;
+        quint32 n = 0;
+        for (int y = 1; y <= view.ny; y++) {
+            const int *row = view.world + y * (view.nx + 2) + 1;
+            for (int x = 0; x < view.nx; x++) {
+                int i = (y - 1) * view.nx + x;
+                qint16 v = qint16(row[x]);
+                if (v == c.sent[i]) continue;
+                c.sent[i] = v;
+                appendUInt32(changes, quint32(i));
+                appendInt16(changes, v);
+                n++;
+            }
+        }
+        // a delta costs 6 bytes per changed cell, a key frame 2 bytes per cell
+        if (6 * qint64(n) <= 2 * qint64(cells)) {
+            appendUInt32(payload, n);
+            payload.append(changes);
+            c.socket->write(message(Delta, payload));
+            return;
+        }
+    }
+
+    c.nx = view.nx;
+    c.ny = view.ny;
+    c.mode = mode;
+    c.sent.resize(cells);
+    appendUInt32(payload, quint32(mode));
+    appendUInt32(payload, quint32(view.nx));
+    appendUInt32(payload, quint32(view.ny));
+    payload.reserve(payload.size() + 2 * cells);
+    for (int y = 1; y <= view.ny; y++) {
+        const int *row = view.world + y * (view.nx + 2) + 1;
+        for (int x = 0; x < view.nx; x++) {
+            qint16 v = qint16(row[x]);
+            c.sent[(y - 1) * view.nx + x] = v;
+            appendInt16(payload, v);
+        }
+    }
+    c.socket->write(message(KeyFrame, payload));
+}
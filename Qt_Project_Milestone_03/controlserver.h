@@ -0,0 +1,107 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <vector>
+#include <QObject>
+#include <QByteArray>
+#include "CAbase.h"
+
+class QLocalServer;
+class QLocalSocket;
+class GameWidget;
+
+class ControlServer : public QObject {
+    /* remote control and frame stream over a local socket (Unix domain socket)
+     *
+     * Messages in both directions are a 1 byte type, a 4 byte payload length and the
+     * payload; all numbers are little-endian. Requests:
+     *
+     *   Start      int32 generations (-1: until stopped)
+     *   Stop, Clear, Subscribe, Unsubscribe (no payload)
+     *   SetInterval int32 msec
+     *   SetMode     int32 universe mode (0 life, 1 snake, 2 predator-prey, 3 unbounded life)
+     *   SetCells    uint32 n, then n x (int32 x, int32 y, int32 value); fails if a cell is
+     *               outside the universe or its value is no state of the mode (life 0, 1;
+     *               predator-prey 0, 1, 2, 5; snake: none), the other cells are still set
+     *
+     * Every request is answered with Ack (uint8 request type, uint8 status, 0: ok). A
+     * subscriber gets a KeyFrame (uint32 generation, int32 mode, int32 nx, int32 ny, nx * ny
+     * int16 states) and then a Delta per new frame (uint32 generation, uint32 n, n x (uint32
+     * cell index, int16 state)) against the last frame it was sent. A subscriber whose
+     * unsent output is above maxPendingBytes skips frames; once its socket has drained it
+     * gets one delta to the newest frame, so a slow client never holds up the game.
+     * Unbounded life has no dense frame and is not streamed.
+     *
+     * The window listens when the program is started with --control <name>.
+     */
+
+    Q_OBJECT
+
+public:
+    enum Message {
+        Start = 1,
+        Stop = 2,
+        Clear = 3,
+        SetInterval = 4,
+        SetMode = 5,
+        SetCells = 6,
+        Subscribe = 7,
+        Unsubscribe = 8,
+        Ack = 0x81,
+        KeyFrame = 0x82,
+        Delta = 0x83
+    };
+
+    static const int headerBytes = 5;
+    static const int maxPayloadBytes = 64 << 20;
+    static const qint64 maxPendingBytes = 1 << 20;
+
+    ControlServer(GameWidget *game, QObject *parent = 0);
+    ~ControlServer();
+
+    // listen on the local socket name (see listenLocal)
+    bool listen(const QString &name);
+
+    QString errorString() const;
+
+signals:
+    void startRequested(int generations);
+    void stopRequested();
+    void clearRequested();
+    void intervalRequested(int msec);
+    void modeRequested(int mode);
+
+public slots:
+    // the game shows a new frame: send it to the subscribers that can take it
+    void publishFrame();
+
+private slots:
+    void acceptClients();
+    void readRequests();
+    void sendPending();
+    void dropClient();
+
+private:
+    struct client {
+        QLocalSocket *socket;
+        QByteArray input;
+        bool subscribed;
+        bool pending;            // a newer frame is waiting for the socket to drain
+        std::vector<qint16> sent; // states of the last frame sent
+        int nx;
+        int ny;
+        int mode;
+    };
+
+    client *find(QObject *socket);
+
+    bool handle(client &c, int type, const QByteArray &payload);
+
+    void sendFrame(client &c);
+
+    QLocalServer *server;
+    GameWidget *game;
+    std::vector<client*> clients;
+};
+
+#endif // CONTROLSERVER_H
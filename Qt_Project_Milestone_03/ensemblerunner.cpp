@@ -0,0 +1,121 @@
+#include <vector>
+#include <QFile>
+#include <QTextStream>
+
+#include "CAbase.h"
+#include "ensemblerunner.h"
+#include "workstealingpool.h"
+
+
+void EnsembleRunner::moments::add(double x) {
+    n += 1;
+    double delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+}
+
+
+void EnsembleRunner::moments::merge(const moments &other) {
+    /* combine two partial results (Chan et al.) */
+
+    if (other.n == 0) return;
+    if (n == 0) {
+        *this = other;
+        return;
+    }
+    double total = n + other.n;
+    double delta = other.mean - mean;
+    mean += delta * other.n / total;
+    m2 += other.m2 + delta * delta * n * other.n / total;
+    n = total;
+}
+
+
+EnsembleRunner::EnsembleRunner(int universeSize, int generations) :
+    universeSize(universeSize),
+    generations(generations),
+    runsPerPoint(1),
+    baseSeed(1),
+    threads(0)
+{
+}
+
+
+void EnsembleRunner::run() {
+    /* simulate all runs and merge the per-worker statistics */
+
+    WorkStealingPool pool(threads);
+    int workers = pool.getThreadCount();
+    const moments zero = {0, 0, 0};
+    const size_t statCount = size_t(pointCount()) * (generations + 1) * 3;
+
+    // one board and one set of accumulators per worker, reused for all of its runs
+    std::vector<CAbase> boards;
+    boards.reserve(workers);
+    std::vector<std::vector<moments> > partial(workers, std::vector<moments>(statCount, zero));
+    for (int w = 0; w < workers; w++) {
+        boards.emplace_back(universeSize, universeSize);
+    }
+
+    pool.run(getRunCount(), [&](int task, int worker) {
+        int point = task / runsPerPoint;
+        double density = densities[point / lifetimes.size()];
+        int lifetime = lifetimes[point % lifetimes.size()];
+
+        CAbase &ca = boards[worker];
+        std::vector<moments> &acc = partial[worker];
+        ca.resetWorldSize(universeSize, universeSize);
+        ca.setSeed(baseSeed + unsigned(task)); // independent random stream per run
+        ca.lifeTimeUI = lifetime;
+        ca.putRandomPredator(density, lifetime);
+
+        int count[3];
+        ca.countPredator(count[0], count[1], count[2]);
+        for (int g = 0; g <= generations; g++) {
+            // once nothing lives any more the populations stay the same
+            if (g > 0 && !ca.isNotChanged()) {
+                ca.worldEvolutionPredator();
+                ca.countPredator(count[0], count[1], count[2]);
+            }
+            for (int s = 0; s < 3; s++) {
+                acc[statIndex(point, g, s)].add(count[s]);
+            }
+        }
+    });
+
+    stats.assign(statCount, zero);
+    for (int w = 0; w < workers; w++) {
+        for (size_t i = 0; i < statCount; i++) {
+            stats[i].merge(partial[w][i]);
+        }
+    }
+}
+
+
+bool EnsembleRunner::writeCsv(const QString &filename) const {
+    /* one line per parameter point and generation with mean and variance of each population */
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out << "density,lifetime,generation,runs,"
+           "predator_mean,predator_var,prey_mean,prey_var,food_mean,food_var\n";
+
+    for (int point = 0; point < pointCount() && !stats.empty(); point++) {
+        double density = densities[point / lifetimes.size()];
+        int lifetime = lifetimes[point % lifetimes.size()];
+        for (int g = 0; g <= generations; g++) {
+            out << density << "," << lifetime << "," << g << "," << runsPerPoint;
+            for (int s = 0; s < 3; s++) {
+                const moments &m = stats[statIndex(point, g, s)];
+                out << "," << m.mean << "," << m.variance();
+            }
+            out << "\n";
+        }
+    }
+    out.flush();
+    file.close();
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef ENSEMBLERUNNER_H
+#define ENSEMBLERUNNER_H
+
+#include <vector>
+#include <QString>
+
+class EnsembleRunner {
+    /* run many independent Predator simulations and aggregate their population curves
+     *
+     * Every combination of initial density and lifetime is one parameter point, which is
+     * simulated runsPerPoint times with different seeds. The runs are scheduled on a
+     * work-stealing pool; every worker reuses one CAbase and keeps its own accumulators,
+     * which are merged once all runs are done.
+     */
+
+public:
+    EnsembleRunner(int universeSize, int generations);
+
+    void setRunsPerPoint(int n) {
+        runsPerPoint = n;
+    }
+
+    void setBaseSeed(unsigned int s) {
+        baseSeed = s;
+    }
+
+    void setThreads(int n) {
+        threads = n;
+    }
+
+    void addDensity(double d) {
+        densities.push_back(d);
+    }
+
+    void addLifetime(int l) {
+        lifetimes.push_back(l);
+    }
+
+    int getRunCount() const {
+        return int(densities.size() * lifetimes.size()) * runsPerPoint;
+    }
+
+    void run();
+
+    bool writeCsv(const QString &filename) const;
+
+    // running mean and variance (Welford), mergeable across workers
+    struct moments {
+        double n;
+        double mean;
+        double m2;
+
+        void add(double x);
+        void merge(const moments &other);
+        double variance() const {
+            return (n > 1) ? m2 / (n - 1) : 0.0;
+        }
+    };
+
+private:
+    int pointCount() const {
+        return int(densities.size() * lifetimes.size());
+    }
+
+    int statIndex(int point, int generation, int species) const {
+        return (point * (generations + 1) + generation) * 3 + species;
+    }
+
+    int universeSize;
+    int generations;
+    int runsPerPoint;
+    unsigned int baseSeed;
+    int threads;
+    std::vector<double> densities;
+    std::vector<int> lifetimes;
+    std::vector<moments> stats; // per point, generation and species (predator, prey, food)
+};
+
+#endif // ENSEMBLERUNNER_H
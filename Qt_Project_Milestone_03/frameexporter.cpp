@@ -0,0 +1,213 @@
+#include <cstring>
+#include <QBuffer>
+#include <QDir>
+#include <QImage>
+#include <QVector>
+
+#include "frameexporter.h"
+#include "gifencoder.h"
+#include "tracerecorder.h"
+
+
+// the colors of GameWidget: white background, GameWidget::getPredefinedColor for predator-prey, black
+const quint32 FrameExporter::palette[1 << FrameExporter::colorBits] = {
+    0xffffffff, 0xff800000, 0xff00ff00, 0xff008000, 0xff0000ff, 0xff000080, 0xff00ffff, 0xff008080,
+    0xffff00ff, 0xff800080, 0xffffff00, 0xff808000, 0xffff0000, 0xff000000, 0xff000000, 0xff000000
+};
+
+
+FrameExporter::FrameExporter(const QString &path, Format format, int scale) :
+    path(path),
+    format(format),
+    scale(scale < 1 ? 1 : scale),
+    threads(0),
+    queueLength(0),
+    delay(4),
+    nx(0),
+    ny(0),
+    bytesWritten(0),
+    added(0),
+    nextToWrite(0),
+    stopping(false),
+    failed(false)
+{
+}
+
+
+FrameExporter::~FrameExporter() {
+    finish();
+}
+
+
+bool FrameExporter::start(int nx, int ny) {
+    /* open the output and start the workers */
+
+    this->nx = nx;
+    this->ny = ny;
+    if (format == Gif) {
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            error = QString("could not write %1").arg(path);
+            return false;
+        }
+        QByteArray header = GifEncoder::header(nx * scale, ny * scale, palette, colorBits);
+        file.write(header);
+        bytesWritten = header.size();
+    } else if (!QDir().mkpath(path)) {
+        error = QString("could not create %1").arg(path);
+        return false;
+    }
+
+    int n = threads;
+    if (n <= 0) n = int(std::thread::hardware_concurrency());
+    if (n <= 0) n = 1;
+    if (queueLength <= 0) queueLength = 2 * n;
+
+    stopping = false;
+    for (int w = 0; w < n; w++) {
+        workers.push_back(std::thread([this]() { work(); }));
+    }
+    return true;
+}
+
+
+bool FrameExporter::addFrame(const CAview &view, int mode) {
+    /* copy the board as palette indices, then wait for room in the pipeline */
+
+    CA_TRACE_SCOPE("FrameExporter", "addFrame");
+
+    if (workers.empty() || view.nx != nx || view.ny != ny) return false;
+
+    frame *f = new frame;
+    f->mode = mode;
+    f->ok = false;
+    f->states.resize(size_t(nx) * ny);
+    for (int y = 1; y <= ny; y++) {
+        const int *row = view.world + y * (nx + 2) + 1;
+        uchar *out = f->states.data() + size_t(y - 1) * nx;
+        for (int x = 0; x < nx; x++) {
+            out[x] = uchar(paletteIndex(row[x], mode));
+        }
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    written.wait(guard, [this]() { return added - nextToWrite < queueLength || failed; });
+    if (failed) {
+        delete f;
+        return false;
+    }
+    f->index = added++;
+    queue.push_back(f);
+    queued.notify_one();
+    return true;
+}
+
+
+bool FrameExporter::finish() {
+    /* drain the pipeline, stop the workers and close the output */
+
+    if (workers.empty()) return !failed;
+
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        written.wait(guard, [this]() { return nextToWrite == added; });
+        stopping = true;
+    }
+    queued.notify_all();
+    for (std::thread &t : workers) {
+        t.join();
+    }
+    workers.clear();
+
+    if (format == Gif) {
+        QByteArray trailer = GifEncoder::trailer();
+        file.write(trailer);
+        bytesWritten += trailer.size();
+        file.close();
+        if (file.error() != QFileDevice::NoError && !failed) {
+            failed = true;
+            error = QString("could not write %1").arg(path);
+        }
+    }
+    return !failed;
+}
+
+
+void FrameExporter::work() {
+    /* worker thread: take the oldest queued frame, encode it, hand it over for writing */
+
+    for (;;) {
+        frame *f;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            queued.wait(guard, [this]() { return !queue.empty() || stopping; });
+            if (queue.empty()) return;
+            f = queue.front();
+            queue.pop_front();
+        }
+        f->ok = encode(*f);
+        deliver(f);
+    }
+}
+
+
+bool FrameExporter::encode(frame &f) {
+    /* rasterise with integer scaling and encode; PNG files are written right here */
+
+    CA_TRACE_SCOPE("FrameExporter", "encode");
+
+    const int width = nx * scale;
+    const int height = ny * scale;
+    QImage image(width, height, QImage::Format_Indexed8);
+    if (image.isNull()) return false;
+    QVector<QRgb> colors;
+    for (quint32 c : palette) {
+        colors.append(QRgb(c));
+    }
+    image.setColorTable(colors);
+
+    for (int y = 0; y < ny; y++) {
+        // the first line of a cell row is built cell by cell, the others are copies of it
+        uchar *line = image.scanLine(y * scale);
+        const uchar *states = f.states.data() + size_t(y) * nx;
+        for (int x = 0; x < nx; x++) {
+            std::memset(line + x * scale, states[x], size_t(scale));
+        }
+        for (int k = 1; k < scale; k++) {
+            std::memcpy(image.scanLine(y * scale + k), line, size_t(width));
+        }
+    }
+
+    if (format == Gif) {
+        f.encoded = GifEncoder::frame(image.constBits(), width, height, image.bytesPerLine(), delay, colorBits);
+        return true;
+    }
+
+    QBuffer buffer(&f.encoded);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "PNG")) return false;
+    QFile out(QString("%1/frame-%2.png").arg(path).arg(f.index, 6, 10, QChar('0')));
+    return out.open(QIODevice::WriteOnly | QIODevice::Truncate) && out.write(f.encoded) == f.encoded.size();
+}
+
+
+void FrameExporter::deliver(frame *f) {
+    /* write out the frames that are now next in order (GIF), then make room for new ones */
+
+    std::lock_guard<std::mutex> guard(lock);
+    completed[f->index] = f;
+    for (auto it = completed.find(nextToWrite); it != completed.end(); it = completed.find(nextToWrite)) {
+        frame *next = it->second;
+        if (!next->ok) {
+            if (!failed) error = QString("could not encode frame %1").arg(next->index);
+            failed = true;
+        } else {
+            if (format == Gif && !failed) file.write(next->encoded);
+            bytesWritten += next->encoded.size();
+        }
+        completed.erase(it);
+        delete next;
+        nextToWrite++;
+    }
+    written.notify_all();
+}
@@ -0,0 +1,118 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <QFile>
+#include <QString>
+#include "CAbase.h"
+
+class FrameExporter {
+    /* offscreen movie of a run: a PNG sequence or an animated GIF
+     *
+     * The caller steps the board and hands every generation to addFrame, which only copies
+     * the states. Worker threads rasterise a frame into a palette-indexed QImage with every
+     * cell scale x scale pixels and encode it (PNG through Qt, GIF with GifEncoder); the GIF
+     * frames are written in generation order by whichever worker completes the next one.
+     * At most queueLength frames are in flight between addFrame and the file, so slow
+     * encoders hold up the stepping rather than filling memory.
+     */
+
+public:
+    enum Format {
+        Png, // <path>/frame-000000.png ...
+        Gif  // one animated GIF at <path>
+    };
+
+    FrameExporter(const QString &path, Format format, int scale = 4);
+    ~FrameExporter();
+
+    void setThreads(int n) {
+        threads = n;
+    }
+
+    void setQueueLength(int n) {
+        queueLength = n;
+    }
+
+    // time a GIF frame is shown, 1/100 s
+    void setDelay(int centiseconds) {
+        delay = centiseconds;
+    }
+
+    // open the output and start the workers for boards of nx x ny cells
+    bool start(int nx, int ny);
+
+    // queue the board of a universe mode (0 life, 1 snake, 2 predator-prey), waits while the queue is full
+    bool addFrame(const CAview &view, int mode);
+
+    // wait until every frame is written and close the output
+    bool finish();
+
+    QString errorString() const {
+        return error;
+    }
+
+    int getThreadCount() const {
+        return int(workers.size());
+    }
+
+    qint64 getBytesWritten() const {
+        return bytesWritten;
+    }
+
+    static const int colorBits = 4;
+
+    // 0xAARRGGBB of the palette indices: background, the predator-prey cell colors, cells of the other modes
+    static const quint32 palette[1 << colorBits];
+
+    static int paletteIndex(int state, int mode) {
+        if (state == 0) return 0;
+        if (mode == 2) return (state > 0 && state < 12) ? state : 13;
+        return 13;
+    }
+
+private:
+    struct frame {
+        int index;
+        int mode;
+        std::vector<uchar> states; // palette indices, nx * ny
+        QByteArray encoded;
+        bool ok;
+    };
+
+    void work();
+
+    bool encode(frame &f);
+
+    void deliver(frame *f);
+
+    QString path;
+    Format format;
+    int scale;
+    int threads;
+    int queueLength;
+    int delay;
+    int nx;
+    int ny;
+    QFile file;
+    QString error;
+    qint64 bytesWritten;
+
+    std::vector<std::thread> workers;
+    std::mutex lock; // guards everything below
+    std::condition_variable queued;  // a frame was queued or the exporter is finishing
+    std::condition_variable written; // a frame left the pipeline
+    std::deque<frame*> queue;        // waiting for a worker, oldest first
+    std::map<int, frame*> completed; // encoded, waiting for the frames before them
+    int added;
+    int nextToWrite;
+    bool stopping;
+    bool failed;
+};
+
+#endif // FRAMEEXPORTER_H
@@ -0,0 +1,108 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "framepublisher.h"
+
+
+FramePublisher::FramePublisher(const QString &name) :
+    name(name),
+    header(0),
+    mappedBytes(0),
+    published(0)
+{
+}
+
+
+FramePublisher::~FramePublisher() {
+    close();
+}
+
+
+bool FramePublisher::open(int maxCells, int slots) {
+    /* create and map the region; readers can attach once the header is written */
+
+    close();
+    if (maxCells < 1 || slots < 2) return false;
+
+    QByteArray path = name.toLocal8Bit();
+    shm_unlink(path.constData());
+    int fd = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+
+    uint32_t slotBytes = ca_frame_slot_bytes(uint32_t(maxCells));
+    size_t bytes = sizeof(ca_frame_header) + size_t(slots) * slotBytes;
+    void *region = MAP_FAILED;
+    if (ftruncate(fd, off_t(bytes)) == 0) {
+        region = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (region == MAP_FAILED) {
+        shm_unlink(path.constData());
+        return false;
+    }
+
+    // the new region is zero filled: no frame published, every seqlock even
+    header = static_cast<ca_frame_header*>(region);
+    header->version = CA_FRAME_VERSION;
+    header->slots = uint32_t(slots);
+    header->slot_bytes = slotBytes;
+    header->max_cells = uint32_t(maxCells);
+    // readers can map the region as soon as the name exists, the magic marks the header complete
+    __atomic_store_n(&header->magic, CA_FRAME_MAGIC, __ATOMIC_RELEASE);
+    mappedBytes = bytes;
+    published = 0;
+    return true;
+}
+
+
+void FramePublisher::close() {
+    if (!header) return;
+
+    munmap(header, mappedBytes);
+    shm_unlink(name.toLocal8Bit().constData());
+    header = 0;
+    mappedBytes = 0;
+}
+
+
+bool FramePublisher::publish(const CAview &view, int mode) {
+    /* pack the board into the slot of the next frame under its seqlock */
+
+    CA_TRACE_SCOPE("FramePublisher", "publish");
+
+    if (!header || qint64(view.nx) * view.ny > header->max_cells) return false;
+
+    quint64 frame = published + 1;
+    ca_frame_slot *slot = const_cast<ca_frame_slot*>(ca_frame_slot_at(header, frame));
+    int16_t *world = const_cast<int16_t*>(ca_frame_world(slot));
+    int16_t *lifetime = const_cast<int16_t*>(ca_frame_lifetime(slot, header->max_cells));
+
+    // readers that see an odd counter or a changed one throw away what they read
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->frame = frame;
+    slot->generation = view.generation;
+    slot->mode = mode;
+    slot->nx = view.nx;
+    slot->ny = view.ny;
+    for (int y = 1; y <= view.ny; y++) {
+        const int *cells = view.world + y * (view.nx + 2) + 1;
+        const int *expiries = view.lifetime + y * (view.nx + 2) + 1;
+        int16_t *w = world + size_t(y - 1) * view.nx;
+        int16_t *l = lifetime + size_t(y - 1) * view.nx;
+        for (int x = 0; x < view.nx; x++) {
+            w[x] = int16_t(cells[x]);
+            l[x] = int16_t(std::min(CAexpiry::lifetime(expiries[x], view.generation), int(CAbase::maxLifetime)));
+        }
+    }
+
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->published, frame, __ATOMIC_RELEASE);
+    published = frame;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef FRAMEPUBLISHER_H
+#define FRAMEPUBLISHER_H
+
+#include <QString>
+#include "CAbase.h"
+#include "caframe.h"
+
+class FramePublisher {
+    /* writer of the shared-memory frame ring (layout in caframe.h, C reader in caframereader.h)
+     *
+     * Every published frame packs the states and lifetimes of a board into the next of
+     * `slots` slots under the slot's seqlock. The writer never waits for readers: a reader
+     * that is still inside a slot when the writer comes around again retries.
+     */
+
+public:
+    explicit FramePublisher(const QString &name = CA_FRAME_DEFAULT_NAME);
+    ~FramePublisher();
+
+    // create the region for boards of up to maxCells cells (replaces a region of the same name)
+    bool open(int maxCells = 2048 * 2048, int slots = 4);
+
+    // unmap and remove the region, readers keep their mapping until they close it
+    void close();
+
+    bool isOpen() const {
+        return header != 0;
+    }
+
+    const QString &getName() const {
+        return name;
+    }
+
+    // publish the board as the newest frame, false if it does not fit
+    bool publish(const CAview &view, int mode);
+
+    quint64 getPublished() const {
+        return published;
+    }
+
+private:
+    QString name;
+    ca_frame_header *header;
+    size_t mappedBytes;
+    quint64 published;
+};
+
+#endif // FRAMEPUBLISHER_H
@@ -0,0 +1,330 @@
+#include <climits>
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include "gamefile.h"
+#include "tracerecorder.h"
+
+
+static const int maxLifetimeCode = __INT16_MAX__;
+
+static const int batchCells = 1 << 20; // cells formatted per write
+
+
+static void appendCode(QByteArray &out, int c) {
+    /* one character: ASCII as is, codes up to 255 as two UTF-8 bytes */
+
+    if (c < 0x80) {
+        out.append(char(c));
+    } else {
+        out.append(char(0xc0 | (c >> 6)));
+        out.append(char(0x80 | (c & 0x3f)));
+    }
+}
+
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+
+static bool readInt(const char *&p, const char *end, int &v) {
+    /* the next whitespace separated decimal number */
+
+    while (p < end && isSpace(*p)) p++;
+    bool negative = (p < end && *p == '-');
+    if (negative) p++;
+    if (p == end || *p < '0' || *p > '9') return false;
+    qint64 n = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        n = 10 * n + (*p++ - '0');
+        if (n > INT_MAX) return false;
+    }
+    v = int(negative ? -n : n);
+    return true;
+}
+
+
+static bool readRow(const char *&p, const char *end, int size, int *out, int mode, bool lifetimes) {
+    /* the next row of size characters, decoded back into states or lifetimes */
+
+    while (p < end && isSpace(*p)) p++;
+    for (int x = 0; x < size; x++) {
+        if (p == end || isSpace(*p)) return false;
+        int c = quint8(*p++);
+        if (c >= 0x80 && p < end) {
+            c = ((c & 0x1f) << 6) | (quint8(*p++) & 0x3f);
+        }
+        out[x] = lifetimes ? GameFile::lifetimeValue(c) : GameFile::cellValue(mode, c);
+    }
+    return p == end || isSpace(*p);
+}
+
+
+GameFile::GameFile(QObject *parent) :
+    QObject(parent),
+    busy(false),
+    saving(false),
+    lastPercent(-1)
+{
+    connect(&watcher, SIGNAL(finished()), this, SLOT(finished()));
+}
+
+
+GameFile::~GameFile() {
+    watcher.waitForFinished();
+}
+
+
+int GameFile::cellChar(int mode, int value) {
+    switch (mode) {
+    case 1: // snake: F food, H head, I, J, ... body by age, G ground
+        if (value == 5) return 'F';
+        if (value >= 10) return ('H' + value - 10) & 0xff;
+        return 'G';
+    case 2: // predator-prey: J predator, G prey, F food, o empty
+        if (value == 1) return 'J';
+        if (value == 2) return 'G';
+        if (value == 5) return 'F';
+        return 'o';
+    default: // life
+        return (value == 1) ? '*' : 'o';
+    }
+}
+
+
+int GameFile::cellValue(int mode, int c) {
+    switch (mode) {
+    case 1:
+        if (c == 'F') return 5;
+        if (c >= 'H') return 10 + c - 'H';
+        return 0;
+    case 2:
+        if (c == 'F') return 5;
+        if (c == 'G') return 2;
+        if (c == 'J') return 1;
+        return 0;
+    default:
+        return (c == '*') ? 1 : 0;
+    }
+}
+
+
+int GameFile::lifetimeChar(int lifetime) {
+    // A: unlimited, B + n: n generations left
+    if (lifetime == maxLifetimeCode) return 'A';
+    if (lifetime <= 0) return 'B';
+    return ('B' + lifetime) & 0xff;
+}
+
+
+int GameFile::lifetimeValue(int c) {
+    if (c == 'A') return maxLifetimeCode;
+    if (c > 'B') return c - 'B';
+    return 0;
+}
+
+
+void GameFile::save(const QString &filename, state s) {
+    if (isBusy()) return;
+    busy = true;
+    job = std::move(s);
+    saving = true;
+    lastPercent = -1;
+    watcher.setFuture(QtConcurrent::run([this, filename]() { return write(filename); }));
+}
+
+
+void GameFile::load(const QString &filename, int mode) {
+    if (isBusy()) return;
+    busy = true;
+    job = state();
+    job.mode = mode;
+    saving = false;
+    lastPercent = -1;
+    watcher.setFuture(QtConcurrent::run([this, filename]() { return read(filename); }));
+}
+
+
+GameFile::state GameFile::takeLoaded() {
+    state s = std::move(job);
+    job = state();
+    return s;
+}
+
+
+void GameFile::finished() {
+    /* back on the window thread: the job and its error can be read again */
+
+    bool ok = watcher.result();
+    busy = false;
+    if (saving) {
+        job = state();
+        emit saved(ok);
+    } else {
+        emit loaded(ok);
+    }
+}
+
+
+void GameFile::report(qint64 done, qint64 total) {
+    // queued to the window thread, once per percent
+    int percent = total > 0 ? int(100 * done / total) : 100;
+    if (percent != lastPercent) {
+        lastPercent = percent;
+        emit progress(percent);
+    }
+}
+
+
+QByteArray GameFile::formatRows(const std::vector<int> &cells, bool lifetimes, int firstRow, int rows) const {
+    QByteArray out;
+    out.reserve(rows * (job.size + 1));
+    for (int y = firstRow; y < firstRow + rows; y++) {
+        const int *row = cells.data() + size_t(y) * job.size;
+        for (int x = 0; x < job.size; x++) {
+            appendCode(out, lifetimes ? lifetimeChar(row[x]) : cellChar(job.mode, row[x]));
+        }
+        out.append('\n');
+    }
+    return out;
+}
+
+
+bool GameFile::write(const QString &filename) {
+    /* pool thread: the lines of the game, written in batches of rows */
+
+    CA_TRACE_SCOPE("io", "saveGame");
+
+    const state &s = job;
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    QByteArray size = QByteArray::number(s.size) + "\n";
+    QByteArray color = QByteArray::number(s.red) + " " + QByteArray::number(s.green) + " " +
+                       QByteArray::number(s.blue) + "\n";
+    QByteArray interval = QByteArray::number(s.interval) + "\n";
+
+    QByteArray head, middle, tail;
+    switch (s.mode) {
+    case 1:
+        head = size + color + interval +
+               QByteArray::number(s.directionPast) + "\n" + QByteArray::number(s.directionFuture) + "\n" +
+               QByteArray::number(s.snakeLength) + "\n" + QByteArray::number(s.snakeAction) + "\n" +
+               QByteArray::number(s.headX) + " " + QByteArray::number(s.headY) + "\n" +
+               QByteArray::number(s.foodX) + " " + QByteArray::number(s.foodY) + "\n";
+        break;
+    case 2:
+        head = size + color + interval + QByteArray::number(s.cellMode) + "\n";
+        middle = QByteArray::number(s.lifetime) + "\n";
+        break;
+    default:
+        head = size;
+        tail = color + interval;
+        break;
+    }
+
+    const int batch = qMax(1, batchCells / qMax(s.size, 1));
+    const int passes = (s.mode == 2) ? 2 : 1;
+    file.write(head);
+    for (int pass = 0; pass < passes; pass++) {
+        if (pass == 1) file.write(middle);
+        const std::vector<int> &cells = (pass == 0) ? s.world : s.lifetimes;
+        for (int y = 0; y < s.size; y += batch) {
+            file.write(formatRows(cells, pass == 1, y, qMin(batch, s.size - y)));
+            report(qint64(pass) * s.size + y, qint64(passes) * s.size);
+        }
+    }
+    file.write(tail);
+
+    if (!file.commit()) {
+        error = file.errorString();
+        return false;
+    }
+    report(1, 1);
+    return true;
+}
+
+
+bool GameFile::read(const QString &filename) {
+    /* pool thread: read the file in chunks (first half of the progress), then parse it */
+
+    CA_TRACE_SCOPE("io", "loadGame");
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    const qint64 total = file.size();
+    QByteArray data;
+    data.reserve(int(qMin(total, qint64(INT_MAX))));
+    while (!file.atEnd()) {
+        QByteArray chunk = file.read(batchCells);
+        if (chunk.isEmpty()) {
+            error = file.errorString();
+            return false;
+        }
+        data.append(chunk);
+        report(data.size(), 2 * total);
+    }
+    return parse(data, job.mode);
+}
+
+
+bool GameFile::parse(const QByteArray &data, int mode) {
+    /* the lines written by write(), in the layout of the mode */
+
+    state &s = job;
+    const char *p = data.constData();
+    const char *end = p + data.size();
+    const qint64 total = 2 * qint64(data.size());
+    error = tr("The file is not a saved game of this mode.");
+
+    s.mode = mode;
+    s.cellMode = 0;
+    s.lifetime = 0;
+    s.directionPast = s.directionFuture = s.snakeLength = s.snakeAction = 0;
+    s.headX = s.headY = s.foodX = s.foodY = 0;
+    if (!readInt(p, end, s.size) || s.size < 1) return false;
+
+    bool header = true;
+    if (mode == 1) {
+        header = readInt(p, end, s.red) && readInt(p, end, s.green) && readInt(p, end, s.blue) &&
+                 readInt(p, end, s.interval) && readInt(p, end, s.directionPast) &&
+                 readInt(p, end, s.directionFuture) && readInt(p, end, s.snakeLength) &&
+                 readInt(p, end, s.snakeAction) && readInt(p, end, s.headX) && readInt(p, end, s.headY) &&
+                 readInt(p, end, s.foodX) && readInt(p, end, s.foodY);
+    } else if (mode == 2) {
+        header = readInt(p, end, s.red) && readInt(p, end, s.green) && readInt(p, end, s.blue) &&
+                 readInt(p, end, s.interval) && readInt(p, end, s.cellMode);
+    }
+    if (!header) return false;
+
+    const int passes = (mode == 2) ? 2 : 1;
+    const size_t cells = size_t(s.size) * s.size;
+    s.world.resize(cells);
+    if (mode == 2) s.lifetimes.resize(cells);
+    for (int pass = 0; pass < passes; pass++) {
+        if (pass == 1 && !readInt(p, end, s.lifetime)) return false;
+        int *out = (pass == 0) ? s.world.data() : s.lifetimes.data();
+        for (int y = 0; y < s.size; y++) {
+            if (!readRow(p, end, s.size, out + size_t(y) * s.size, mode, pass == 1)) return false;
+            if ((y & 255) == 0) report(data.size() + (p - data.constData()), total);
+        }
+    }
+
+    if (mode == 0 || mode == 3) {
+        if (!readInt(p, end, s.red) || !readInt(p, end, s.green) || !readInt(p, end, s.blue) ||
+                !readInt(p, end, s.interval))
+            return false;
+    }
+    error.clear();
+    report(1, 1);
+    return true;
+}
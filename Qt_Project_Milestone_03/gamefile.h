@@ -0,0 +1,103 @@
+#ifndef GAMEFILE_H
+#define GAMEFILE_H
+
+#include <vector>
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QFutureWatcher>
+
+class GameFile : public QObject {
+    /* saving and loading games without blocking the window
+     *
+     * The window takes a copy of the game (a state) on its own thread, which is one pass
+     * over the board; formatting and writing, or reading and parsing, run on a pool thread
+     * with QtConcurrent. A save goes to a temporary file that replaces the target only
+     * once it is complete (QSaveFile), so a failed or interrupted save never leaves half a
+     * game behind. Progress is reported in percent. A loaded state is handed back to the
+     * window thread, which swaps it into the game between two generations.
+     *
+     * The file format is the text format of the earlier synchronous save, one character
+     * per cell (see cellChar); files of either version load in the other.
+     */
+
+    Q_OBJECT
+
+public:
+    struct state {
+        int mode;           // universe mode: 0 life, 1 snake, 2 predator-prey, 3 unbounded life (viewport)
+        int size;
+        int red;
+        int green;
+        int blue;
+        int interval;
+        int cellMode;       // predator-prey
+        int lifetime;       // predator-prey, lifetime of new cells
+        int directionPast;  // snake
+        int directionFuture;
+        int snakeLength;
+        int snakeAction;
+        int headX;
+        int headY;
+        int foodX;
+        int foodY;
+        std::vector<int> world;     // size * size states, row by row
+        std::vector<int> lifetimes; // predator-prey, same layout
+    };
+
+    explicit GameFile(QObject *parent = 0);
+    ~GameFile();
+
+    // from save() or load() until saved() or loaded() has been emitted
+    bool isBusy() const {
+        return busy;
+    }
+
+    // format and write s on a pool thread, saved() reports the outcome
+    void save(const QString &filename, state s);
+
+    // read and parse a game of the mode on a pool thread, loaded() reports the outcome
+    void load(const QString &filename, int mode);
+
+    // the state of the last successful load
+    state takeLoaded();
+
+    QString errorString() const {
+        return error;
+    }
+
+    // one character per cell and back; codes above 127 are written as UTF-8
+    static int cellChar(int mode, int value);
+    static int cellValue(int mode, int c);
+    static int lifetimeChar(int lifetime);
+    static int lifetimeValue(int c);
+
+signals:
+    void progress(int percent);
+    void saved(bool ok);
+    void loaded(bool ok);
+
+private slots:
+    void finished();
+
+private:
+    bool write(const QString &filename);
+
+    bool read(const QString &filename);
+
+    bool parse(const QByteArray &data, int mode);
+
+    // one line per row of cells (states, or lifetimes if lifetimes is set)
+    QByteArray formatRows(const std::vector<int> &cells, bool lifetimes, int firstRow, int rows) const;
+
+    void report(qint64 done, qint64 total);
+
+    QFutureWatcher<bool> watcher;
+    bool busy;        // the watcher stops running before its finished() is delivered
+    bool saving;
+    state job;        // touched only by the pool thread while a job runs
+    QString error;    // same
+    int lastPercent;  // same
+};
+
+#endif // GAMEFILE_H
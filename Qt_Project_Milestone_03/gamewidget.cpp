@@ -6,35 +6,84 @@
 #include <QString>
 #include <QPainter>
 #include <QTime>
+#include <QStringList>
+#include <QFontMetrics>
 
 #include <qmath.h>
 #include "gamewidget.h"
 #include "keypressfilter.h"
 
 
+static const int frameIntervalMs = 16; // worker processes: shortest time between two frames fetched for painting
+
+static const int turboBudgetMs = 12;    // turbo mode: stepping time per frame, the rest of frameIntervalMs is for painting
+
+static const int inputTickMs = 16;      // snake: shortest time between two ticks when arrow keys cause early ticks
+
+
 GameWidget::GameWidget(QWidget *parent) :
     QWidget(parent),
     timer(new QTimer(this)),
     timerColor(new QTimer(this)),
     ca1(),
+    caSparse(),
+    autopilot(0),
+    viewportX(-25),
+    viewportY(-25),
     universeSize(50),
     universeMode(0),
     cellMode(0),
     lifeTime(50),
-    generations(-1)
+    generations(-1),
+    perfOverlay(false),
+    clusters(),
+    clusterStats(false),
+    strips(0),
+    stripProcesses(0),
+    frames(),
+    history(),
+    historyPosition(-1),
+    historyModified(false),
+    interval(300),
+    turbo(false),
+    turboStepCost(0),
+    turboBatch(0),
+    snakeInput(),
+    inputTimer(new QTimer(this)),
+    earlyTick(false)
 
 {
-    timer->setInterval(300);
+    timer->setInterval(interval);
     timerColor->setInterval(50);
     masterColor = "#000";
     ca1.resetWorldSize(universeSize, universeSize);
     ca1.lifeTimeUI = lifeTime;
     connect(timer, SIGNAL(timeout()), this, SLOT(newGeneration()));
     connect(timerColor, SIGNAL(timeout()), this, SLOT(newGenerationColor()));
+    inputTimer->setSingleShot(true);
+    connect(inputTimer, SIGNAL(timeout()), this, SLOT(inputTick()));
+    inputClock.start();
+    tickClock.start();
+
+    MetricsRegistry &registry = MetricsRegistry::instance();
+    metrics.generations = registry.counter("ca_generations_total", "Generations stepped.");
+    metrics.step = registry.histogram("ca_step_seconds", "Time to step one generation.");
+    metrics.paint = registry.histogram("ca_paint_seconds", "Time to paint one frame.");
+    metrics.alive = registry.gauge("ca_population", "Cells per state.", "state=\"alive\"");
+    metrics.predators = registry.gauge("ca_population", "Cells per state.", "state=\"predator\"");
+    metrics.prey = registry.gauge("ca_population", "Cells per state.", "state=\"prey\"");
+    metrics.food = registry.gauge("ca_population", "Cells per state.", "state=\"food\"");
+    metrics.snakeLength = registry.gauge("ca_snake_length", "Length of the snake.");
+    metrics.boardBytes = registry.gauge("ca_buffer_bytes", "Bytes allocated per buffer.", "buffer=\"board\"");
+    metrics.sparseBytes = registry.gauge("ca_buffer_bytes", "Bytes allocated per buffer.", "buffer=\"sparse\"");
+    metrics.historyBytes = registry.gauge("ca_buffer_bytes", "Bytes allocated per buffer.", "buffer=\"history\"");
+    metrics.inputLatency = registry.histogram("ca_snake_input_seconds", "Time from an arrow key to the snake move applying it.");
 }
 
 
 GameWidget::~GameWidget() {
+    delete autopilot;
+    delete strips;
 }
 
 
@@ -43,6 +92,8 @@ void GameWidget::startGame(const int &number) {
 
     emit gameStarted(universeMode, true);
     generations = number;
+    if (universeMode == 0 && stripProcesses > 0)
+        startStrips();
     timer->start();
     this->setFocus();
 }
@@ -54,30 +105,39 @@ void GameWidget::stopGame() {
     emit gameStopped(universeMode, true);
     timer->stop();
     timerColor->stop();
+    inputTimer->stop();
+    snakeInput.clear();
+    stopStrips();
+}
+
+
+bool GameWidget::isRunning() const {
+    return timer->isActive();
 }
 
 
 void GameWidget::clearGame() {
-    for (int k = 1; k <= universeSize; k++) {
-        for (int j = 1; j <= universeSize; j++) {
-            ca1.setValue(j, k, 0);
-        }
-    }
+    /* empty the universe of the current mode (the buffers of the board are reused) */
+
     gameEnds(universeMode, true);
     ca1.resetWorldSize(universeSize, universeSize);
+    snakeInput.clear();
 
     // snake
     if (universeMode == 1) {
         ca1.putInitSnake();
         ca1.putNewFood();
-    // predator
-    } else if (universeMode == 2) {
-        for (int k = 1; k <= universeSize; k++) {
-            for (int j = 1; j <= universeSize; j++) {
-                ca1.setLifetime(j, k, ca1.maxLifetime);
-            }
-        }
+    // unbounded life
+    } else if (universeMode == 3) {
+        caSparse.clear();
+        centerViewport();
     }
+    clearHistory();
+    if (strips)
+        strips->load(ca1.view());
+    publishFrame();
+    if (clusterStats)
+        updateClusters();
     update();
 
 }
@@ -89,8 +149,10 @@ int GameWidget::getUniverseSize() {
 
 
 void GameWidget::setUniverseSize(const int &s) {
+    /* in unbounded mode the size only sets the number of cells shown by the viewport */
     universeSize = s;
     ca1.resetWorldSize(s, s);
+    clearHistory();
     update();
 }
 
@@ -119,212 +181,275 @@ void GameWidget::setCellMode(const int &m) {
 }
 
 
-CAbase GameWidget::getCA() {
-    return ca1;
+bool GameWidget::setCell(int x, int y, int value) {
+    /* set one cell of the current universe from outside (see ControlServer), x, y from 1
+     *
+     * Only states a user could put are accepted: life 0 or 1, predator-prey 0 (empty),
+     * 1 (predator), 2 (prey) or 5 (food). The snake and its food are kept by the game and
+     * cannot be edited. Returns false (and changes nothing) for anything else.
+     */
+
+    bool valid = (universeMode == 2) ? (value == 0 || value == 1 || value == 2 || value == 5)
+                                     : (universeMode != 1 && (value == 0 || value == 1));
+    if (!valid)
+        return false;
+
+    if (universeMode == 3) {
+        caSparse.setValue(x, y, value);
+    } else {
+        if (x < 1 || y < 1 || x > universeSize || y > universeSize)
+            return false;
+        ca1.setValue(x, y, value);
+        // predators and prey start with the lifetime set in the ui, like cells put with the mouse
+        if (universeMode == 2)
+            ca1.setLifetime(x, y, (value == 1 || value == 2) ? lifeTime : ca1.maxLifetime);
+    }
+    historyModified = true;
+    update();
+    return true;
+}
+
+
+CAview GameWidget::getView() const {
+    /* read-only state of the dense universe, valid until the next generation (see CAview) */
+    return ca1.view();
 }
 
 
-QString GameWidget::dumpGame(char member) {
-    /* dump current universe into a string*/
+CAsnapshot GameWidget::getSnapshot() const {
+    /* copy of the dense universe that stays valid while the game goes on */
+    return ca1.snapshot();
+}
 
-    char temp;
-    QString master = "";
 
-    switch (universeMode) {
+void GameWidget::getState(GameFile::state &s) {
+    /* copy of the board for GameFile, one pass on the window thread (unbounded life: the viewport) */
 
-    // GAME OF LIFE
-    case 0:
-        for (int k = 1; k <= universeSize; k++) {
-            for (int j = 1; j <= universeSize; j++) {
-                if (ca1.getValue(j, k) == 1) {
-                    temp = '*';
-                } else {
-                    temp = 'o';
-                }
-                master.append(temp);
+    const int n = universeSize;
+    s.mode = universeMode;
+    s.size = n;
+    s.world.resize(size_t(n) * n);
+    s.lifetimes.clear();
+
+    if (universeMode == 3) {
+        for (int k = 0; k < n; k++) {
+            for (int j = 0; j < n; j++) {
+                s.world[size_t(k) * n + j] = caSparse.getValue(viewportX + j, viewportY + k);
             }
-            master.append("\n");
         }
-        return master;
-        break;
+        return;
+    }
 
-    // SNAKE
-    case 1:
-        for (int k = 1; k <= universeSize; k++) {
-            for (int j = 1; j <= universeSize; j++) {
-                int value = ca1.getValue(j, k);
-                if (value == 5) {
-                    temp = 'F';
-                } else if (value == 10) {
-                    temp = 'H';
-                } else if (value > 10) {
-                    temp = 'H' + value - 10;
-                } else {
-                    temp = 'G';
-                }
-                master.append(temp);
+    CAview view = ca1.view();
+    if (universeMode == 2) s.lifetimes.resize(size_t(n) * n);
+    for (int k = 0; k < n; k++) {
+        const int *row = view.world + (k + 1) * (n + 2) + 1;
+        std::copy(row, row + n, s.world.begin() + size_t(k) * n);
+        if (universeMode == 2) {
+            // the board keeps expiry generations, files keep the generations left
+            const int *expiries = view.lifetime + (k + 1) * (n + 2) + 1;
+            for (int j = 0; j < n; j++) {
+                s.lifetimes[size_t(k) * n + j] = CAexpiry::lifetime(expiries[j], view.generation);
             }
-            master.append("\n");
         }
-        return master;
-        break;
+    }
+    s.directionPast = view.directionPast;
+    s.directionFuture = view.directionFuture;
+    s.snakeLength = view.snakeLength;
+    s.snakeAction = view.snakeAction;
+    s.headX = view.headX;
+    s.headY = view.headY;
+    s.foodX = view.foodX;
+    s.foodY = view.foodY;
+}
 
-    // PREDATOR
-    case 2:
-        if (member == 'v') { // world value
-            for (int k = 1; k <= universeSize; k++) {
-                for (int j = 1; j <= universeSize; j++) {
-                    int value = ca1.getValue(j, k);
-                    if (value == 1) {
-                        temp = 'J';
-                    } else if (value == 2) {
-                        temp = 'G';
-                    } else if (value == 5) {
-                        temp = 'F';
-                    } else {
-                        temp = 'o';
-                    }
-                    master.append(temp);
-                }
-                master.append("\n");
+
+void GameWidget::setState(const GameFile::state &s) {
+    /* cells, lifetimes and snake of a game of the current mode and size; the window sets the rest */
+
+    const int n = universeSize;
+    if (s.size != n || s.world.size() != size_t(n) * n) return;
+
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            int value = s.world[size_t(k) * n + j];
+            if (universeMode == 3) {
+                caSparse.setValue(viewportX + j, viewportY + k, value);
+            } else {
+                ca1.setValue(j + 1, k + 1, value);
             }
-        } else if (member == 'l') { // lifetime
-            for (int k = 1; k <= universeSize; k++) {
-                for (int j = 1; j <= universeSize; j++) {
-                    int lT = ca1.getLifetime(j, k);
-                    if (lT == 0) {
-                        temp = 'B';
-                    } else if (lT == __INT16_MAX__) {
-                        temp = 'A';
-                    } else if (lT > 0 && lT < __INT16_MAX__) {
-                        temp = 'B' + lT;
-                    }
-                    master.append(temp);
-                }
-                master.append("\n");
+        }
+    }
+    if (universeMode == 2 && s.lifetimes.size() == s.world.size()) {
+        for (int k = 0; k < n; k++) {
+            for (int j = 0; j < n; j++) {
+                ca1.setLifetime(j + 1, k + 1, s.lifetimes[size_t(k) * n + j]);
             }
         }
-
-        return master;
-        break;
-
-    default:
-        return master;
-        break;
+    }
+    if (universeMode == 1) {
+        setDirectionSnake(s.directionPast, s.directionFuture);
+        setSnakeLength(s.snakeLength);
+        setSnakeAction(s.snakeAction);
+        setPositionSnakeHead(s.headX, s.headY);
+        setPositionFood(s.foodX, s.foodY);
     }
 
+    historyModified = true;
+    update();
 }
 
 
-void GameWidget::reconstructGame(const QString &data, char member) {
-     /* reconstruct game from dump */
-
-    int current;
-    int ascii_H = (int) 'H';
-    int ascii_B = (int) 'B';
-    int ascii_Char;
+QString GameWidget::dumpGame(char member) {
+    /* dump current universe into a string, one line per row (see GameFile::cellChar) */
+
+    GameFile::state s;
+    getState(s);
+    bool lifetimes = (member == 'l' && universeMode == 2);
+    QString master;
+    for (size_t i = 0; i < s.world.size(); i++) {
+        master.append(QChar(lifetimes ? GameFile::lifetimeChar(s.lifetimes[i]) : GameFile::cellChar(universeMode, s.world[i])));
+        if ((i + 1) % universeSize == 0) master.append("\n");
+    }
+    return master;
+}
 
-    switch (universeMode) {
 
-    // GAME OF LIFE
-    case 0:
-        current = 0;
-        for (int k = 1; k <= universeSize; k++) {
-            for (int j = 1; j <= universeSize; j++) {
-               if (data[current] == '*') {
-                   ca1.setValue(j, k, 1);
-                }
-                current++;
+void GameWidget::reconstructGame(const QString &data, char member) {
+    /* reconstruct game from dump */
+
+    GameFile::state s;
+    getState(s);
+    bool lifetimes = (member == 'l' && universeMode == 2);
+    int current = 0;
+    for (int k = 0; k < universeSize; k++) {
+        for (int j = 0; j < universeSize; j++) {
+            int c = data[current].unicode();
+            size_t i = size_t(k) * universeSize + j;
+            if (lifetimes) {
+                s.lifetimes[i] = GameFile::lifetimeValue(c);
+            } else {
+                s.world[i] = GameFile::cellValue(universeMode, c);
             }
             current++;
         }
-        break;
+        current++;
+    }
+    setState(s);
+}
 
-    // SNAKE
-    case 1:
-        current = 0;
-        for (int k = 1; k <= universeSize; k++) {
-            for (int j = 1; j <= universeSize; j++) {
-                ascii_Char = data[current].unicode();
-                if (data[current] == 'F') {
-                    ca1.setValue(j, k, 5);
-                }
-                else if (ascii_Char >= ascii_H) {
-                    ca1.setValue(j, k, 10 + ascii_Char - ascii_H);
-                } else {
-                    ca1.setValue(j, k, 0);
-                }
-                current++;
-            }
-            current++;
-        }
-        break;
 
-    // PREDATOR
-    case 2:
-        if (member == 'v') { // world values
-            current = 0;
-            for (int k = 1; k <= universeSize; k++) {
-                for (int j = 1; j <= universeSize; j++) {
-                    ascii_Char = data[current].unicode();
-                    if (data[current] == 'F') {
-                        ca1.setValue(j, k, 5);
-                    }
-                    else if (data[current] == 'G') {
-                        ca1.setValue(j, k, 2);
-                    } else if (data[current] == 'J'){
-                        ca1.setValue(j, k, 1);
-                    } else {
-                         ca1.setValue(j, k, 0);
-                    }
-                    current++;
-                }
-                current++;
-            }
-        } else if (member == 'l') { // lifetime values
-            current = 0;
-            for (int k = 1; k <= universeSize; k++) {
-                for (int j = 1; j <= universeSize; j++) {
-                    ascii_Char = data[current].unicode();
-                    if (data[current] == 'A') {
-                        ca1.setLifetime(j, k, __INT16_MAX__);
-                    }
-                    else if (data[current] == 'B') {
-                        ca1.setLifetime(j, k, 0);
-                    } else if (ascii_Char > ascii_B){
-                        ca1.setLifetime(j, k, ascii_Char - ascii_B);
-                    }
-                    current++;
-                }
-                current++;
-            }
-        }
-        break;
+int GameWidget::getInterval() {
+    return interval;
+}
 
-    default:
-        break;
-    }
 
-    update();
+void GameWidget::setInterval(int msec) {
+    interval = msec;
+    if (!turbo)
+        timer->setInterval(msec);
 }
 
 
-int GameWidget::getInterval() {
-    return timer->interval();
+void GameWidget::setTurbo(bool on) {
+    // turbo: a tick per frame, each with as many generations as fit turboBudgetMs
+    turbo = on;
+    turboStepCost = 0;
+    turboBatch = 0;
+    timer->setInterval(on ? frameIntervalMs : interval);
 }
 
 
-void GameWidget::setInterval(int msec) {
-    timer->setInterval(msec);
+//
+// worker processes
+//
+
+void GameWidget::setStripProcesses(int n) {
+    // Life runs on n worker processes while the game is running, 0: in this process
+    stripProcesses = n;
 }
 
 
-void GameWidget::newGeneration() {
-    /* start the evolution of universe and update the game field */
+void GameWidget::startStrips() {
+    /* hand the Life board to the worker processes (see StripCluster) */
 
-    if (generations < 0)
-        generations++;
+    delete strips;
+    strips = new StripCluster(universeSize, universeSize, stripProcesses);
+    if (!strips->start() || !strips->load(ca1.view())) {
+        QMessageBox::warning(this, tr("Worker processes"),
+                             tr("Life runs in this process: %1").arg(strips->errorString()));
+        delete strips;
+        strips = 0;
+        return;
+    }
+    frameClock.start();
+
+    // the board the workers start from stays in the history
+    history.truncate(historyPosition + 1);
+    if (history.isEmpty() || historyModified)
+        recordHistory();
+}
+
+
+void GameWidget::stopStrips() {
+    /* fetch the latest board from the worker processes and let them quit */
+
+    if (!strips)
+        return;
 
+    strips->gather(ca1);
+    delete strips;
+    strips = 0;
+    // the history goes on from the fetched board
+    historyModified = true;
+    update();
+}
+
+
+bool GameWidget::stepStrips() {
+    /* one generation on the worker processes, true if a frame was fetched into ca1 */
+
+    if (historyModified) {
+        // cells were edited on the shown frame, which is the board from now on
+        strips->load(ca1.view());
+        historyModified = false;
+    }
+
+    bool stepped;
+    {
+        CA_PERF_SCOPE(perf, PerfStats::Step);
+        MetricsScope latency(metrics.step);
+        stepped = strips->step(1);
+    }
+    if (!stepped) {
+        QMessageBox::warning(this, tr("Worker processes"),
+                             tr("Stopped: %1").arg(strips->errorString()));
+        delete strips;
+        strips = 0;
+        stopGame();
+        return true;
+    }
+    MetricsRegistry::instance().add(metrics.generations);
+#ifdef CA_PERF
+    perf.countGeneration(qint64(universeSize) * universeSize);
+#endif
+
+    // a repaint is due when the widget is shown and the last frame is old enough, or the game ends
+    bool due = isVisible() && frameClock.elapsed() >= frameIntervalMs;
+    if (!due && !strips->isNotChanged() && generations != 1)
+        return false;
+
+    strips->gather(ca1);
+    frameClock.restart();
+    return true;
+}
+
+
+void GameWidget::evolveUniverse() {
+    /* advance the universe of the current mode by one generation */
+
+    CA_PERF_SCOPE(perf, PerfStats::Step);
+    MetricsScope latency(metrics.step);
     switch (universeMode) {
     // game of life
     case 0:
@@ -332,19 +457,122 @@ void GameWidget::newGeneration() {
         break;
     // snake
     case 1:
-        ca1.worldEvolutionSnake();
+        if (autopilot) {
+            ca1.turnSnake(autopilot->nextDirection(SnakeView::of(ca1)));
+            ca1.worldEvolutionSnake();
+        } else if (!snakeInput.isEmpty()) {
+            // one queued arrow key per move, timed from the key press to the moved snake
+            SnakeInputQueue::input in = snakeInput.pop();
+            ca1.turnSnake(in.direction);
+            ca1.worldEvolutionSnake();
+            qint64 latency = inputClock.nsecsElapsed() - in.time;
+            inputLatency.add(latency);
+            MetricsRegistry::instance().observe(metrics.inputLatency, latency / 1e9);
+        } else {
+            ca1.worldEvolutionSnake();
+        }
+        MetricsRegistry::instance().set(metrics.snakeLength, ca1.getSnakeLength());
         break;
     // predator
     case 2:
         ca1.worldEvolutionPredator();
         break;
+    // unbounded life
+    case 3:
+        caSparse.worldEvolutionLife();
+        break;
     default:
         break;
     }
+    MetricsRegistry::instance().add(metrics.generations);
 
-    update();
+#ifdef CA_PERF
+    if (universeMode == 3) {
+        perf.countGeneration(qint64(caSparse.getTileCount()) * CAsparse::tileSize * CAsparse::tileSize);
+    } else {
+        perf.countGeneration(qint64(universeSize) * universeSize);
+    }
+#endif
+}
 
-    if (ca1.isNotChanged()) {
+
+bool GameWidget::isUniverseUnchanged() {
+    /* true once the game has ended (see CAbase::isNotChanged) */
+
+    CA_PERF_SCOPE(perf, PerfStats::EndCheck);
+    if (strips)
+        return strips->isNotChanged();
+    return (universeMode == 3) ? caSparse.isNotChanged() : ca1.isNotChanged();
+}
+
+
+void GameWidget::newGeneration() {
+    /* start the evolution of universe and update the game field
+     *
+     * One generation per timer tick, or in turbo mode as many as the moving average of
+     * their cost fits into the frame budget. The board is painted and recorded in the
+     * history once per tick (a snapshot compares the whole board, so a turbo batch is
+     * one step of the history); a batch stops early on the generation limit and when
+     * the universe stops changing.
+     */
+
+    CA_TRACE_INSTANT("timer", "tick", "interval_ms", timer->interval());
+    CA_TRACE_SCOPE("GameWidget", "newGeneration");
+
+    tickClock.restart();
+    QElapsedTimer budget;
+    budget.start();
+    bool fetched = false;
+    bool unchanged = false;
+    int stepped = 0;
+
+    if (!strips) {
+        // going on from a rewound generation forgets its old future, edits get a snapshot of their own
+        history.truncate(historyPosition + 1);
+        if (history.isEmpty() || historyModified)
+            recordHistory();
+    }
+
+    for (;;) {
+        if (generations < 0)
+            generations++;
+
+        qint64 start = budget.nsecsElapsed();
+        if (strips) {
+            // worker processes: no history, the board is only fetched when a frame is due
+            fetched = stepStrips() || fetched;
+            if (!timer->isActive())
+                return;
+        } else {
+            evolveUniverse();
+            fetched = true;
+        }
+        stepped++;
+        qint64 cost = budget.nsecsElapsed() - start;
+        turboStepCost = (turboStepCost > 0) ? (7 * turboStepCost + cost) / 8 : cost;
+
+        unchanged = isUniverseUnchanged();
+        if (unchanged || generations == 1)
+            break;
+        if (!turbo || budget.nsecsElapsed() + turboStepCost > qint64(turboBudgetMs) * 1000000)
+            break;
+        generations--;
+    }
+    turboBatch = stepped;
+    if (!strips)
+        recordHistory();
+    CA_TRACE_INSTANT("GameWidget", "batch", "generations", stepped);
+
+    if (fetched) {
+        // update() only schedules the repaint, the work of this stage is handing the frame on
+        CA_PERF_SCOPE(perf, PerfStats::Update);
+        publishFrame();
+        if (clusterStats)
+            updateClusters();
+        update();
+    }
+
+    if (unchanged) {
         const QString headlines[] = {"Evolution stopped!", "Game over!"};
         const QString details[] = {"All future generations will be identical to this one.",
                                    "Your snake hit an obstacle."};
@@ -369,6 +597,12 @@ void GameWidget::newGeneration() {
             msgBox.setText(headlines[0]);
             msgBox.setInformativeText(details[0]);
             break;
+        // unbounded life
+        case 3:
+            msgBox.setIcon(QMessageBox::Information);
+            msgBox.setText(headlines[0]);
+            msgBox.setInformativeText(details[0]);
+            break;
         //
         default:
             break;
@@ -411,14 +645,29 @@ void GameWidget::newGenerationColor() {
 void GameWidget::paintEvent(QPaintEvent *) {
     /* paint the grid and the universe inside ui */
 
+    CA_PERF_SCOPE(perf, PerfStats::Paint);
+    CA_TRACE_SCOPE("GameWidget", "paintEvent");
+    MetricsScope latency(metrics.paint);
     QPainter p(this);
     paintGrid(p);
     paintUniverse(p);
+
+    if (perfOverlay)
+        paintPerfOverlay(p);
+    if (clusterStats)
+        paintClusterOverlay(p);
 }
 
 
 void GameWidget::mousePressEvent(QMouseEvent *e) {
+    // unbounded life: the right button drags the viewport
+    if (universeMode == 3 && e->button() == Qt::RightButton) {
+        panOrigin = e->pos();
+        return;
+    }
+
     emit universeModified(universeMode, true);
+    historyModified = true;
     double cellWidth = (double) width() / universeSize;
     double cellHeight = (double) height() / universeSize;
     int k = floor(e->y() / cellHeight) + 1;
@@ -470,14 +719,35 @@ void GameWidget::mousePressEvent(QMouseEvent *e) {
         }
         update();
     }
+
+    // unbounded life
+    else if (universeMode == 3) {
+        int x = viewportX + j - 1;
+        int y = viewportY + k - 1;
+        caSparse.setValue(x, y, caSparse.getValue(x, y) == 0 ? 1 : 0);
+        update();
+    }
 }
 
 
 void GameWidget::mouseMoveEvent(QMouseEvent *e) {
     double cellWidth = (double) width() / universeSize;
     double cellHeight = (double) height() / universeSize;
+
+    // unbounded life: move the viewport by whole cells while the right button is held
+    if (universeMode == 3 && (e->buttons() & Qt::RightButton)) {
+        int dx = int((e->x() - panOrigin.x()) / cellWidth);
+        int dy = int((e->y() - panOrigin.y()) / cellHeight);
+        if (dx != 0 || dy != 0) {
+            setViewport(viewportX - dx, viewportY - dy);
+            panOrigin += QPoint(int(dx * cellWidth), int(dy * cellHeight));
+        }
+        return;
+    }
+
     int k = floor(e->y() / cellHeight) + 1;
     int j = floor(e->x() / cellWidth) + 1;
+    historyModified = true;
 
     // game of life
     if (universeMode == 0) {
@@ -512,12 +782,22 @@ void GameWidget::mouseMoveEvent(QMouseEvent *e) {
         }
         update();
     }
+    // unbounded life
+    else if (universeMode == 3) {
+        if (caSparse.getValue(viewportX + j - 1, viewportY + k - 1) == 0) {
+            caSparse.setValue(viewportX + j - 1, viewportY + k - 1, 1);
+            update();
+        }
+    }
 }
 
 
 void GameWidget::paintGrid(QPainter &p) {
     /* paint the grid in the ui */
 
+    CA_PERF_SCOPE(perf, PerfStats::PaintGrid);
+    CA_TRACE_SCOPE("GameWidget", "paintGrid");
+
     QRect borders(0, 0, width() - 1, height() - 1); // borders of the universe
     QColor gridColor = masterColor; // color of the grid
     gridColor.setAlpha(10); // must be lighter than main color
@@ -535,8 +815,25 @@ void GameWidget::paintGrid(QPainter &p) {
 void GameWidget::paintUniverse(QPainter &p) {
     /* paint cell values with specific colors into grid */
 
+    CA_PERF_SCOPE(perf, PerfStats::PaintUniverse);
+    CA_TRACE_SCOPE("GameWidget", "paintUniverse");
+
     double cellWidth = (double) width() / universeSize;
     double cellHeight = (double) height() / universeSize;
+    // unbounded life: paint the part of the plane visible through the viewport
+    if (universeMode == 3) {
+        for (int k = 1; k <= universeSize; k++) {
+            for (int j = 1; j <= universeSize; j++) {
+                if (caSparse.getValue(viewportX + j - 1, viewportY + k - 1) != 0) {
+                    QRectF r((qreal) (cellWidth * j - cellWidth), (qreal) (cellHeight * k - cellHeight),
+                             (qreal) cellWidth, (qreal) cellHeight);
+                    p.fillRect(r, QBrush(masterColor));
+                }
+            }
+        }
+        return;
+    }
+
     for (int k = 1; k <= universeSize; k++) {
         for (int j = 1; j <= universeSize; j++) {
             if (ca1.getValue(j, k) != 0) {
@@ -555,6 +852,248 @@ void GameWidget::paintUniverse(QPainter &p) {
 }
 
 
+void GameWidget::paintPerfOverlay(QPainter &p) {
+    /* draw generations/s, cells/s, frame time and step latency in the top left corner */
+
+    QStringList lines;
+#ifdef CA_PERF
+    const PerfHistogram &step = perf.histogram(PerfStats::Step);
+    const PerfHistogram &frame = perf.histogram(PerfStats::Paint);
+    lines << QString("generations/s: %1").arg(perf.generationsPerSecond(), 0, 'f', 1)
+          << QString("cells/s: %1 M").arg(perf.cellsPerSecond() / 1e6, 0, 'f', 2)
+          << QString("frame: %1 ms").arg(frame.mean() / 1e6, 0, 'f', 2)
+          << QString("step p50: %1 us").arg(step.percentile(0.5) / 1e3, 0, 'f', 1)
+          << QString("step p99: %1 us").arg(step.percentile(0.99) / 1e3, 0, 'f', 1);
+#else
+    lines << "instrumentation compiled out (CONFIG+=noperf)";
+#endif
+    if (turbo)
+        lines << QString("turbo: %1 generations/frame").arg(turboBatch);
+    if (universeMode == 1 && inputLatency.getCount() > 0)
+        lines << QString("input p50: %1 ms").arg(inputLatency.percentile(0.5) / 1e6, 0, 'f', 1)
+              << QString("input p99: %1 ms").arg(inputLatency.percentile(0.99) / 1e6, 0, 'f', 1);
+
+    paintTextBox(p, lines, false);
+}
+
+
+void GameWidget::paintTextBox(QPainter &p, const QStringList &lines, bool right) {
+    /* lines of text on a light box in the top left (or top right) corner */
+
+    QFontMetrics metrics(p.font());
+    int lineHeight = metrics.height();
+    int boxWidth = 0;
+    for (const QString &line : lines) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+        boxWidth = qMax(boxWidth, metrics.horizontalAdvance(line));
+#else
+        boxWidth = qMax(boxWidth, metrics.width(line));
+#endif
+    }
+
+    int left = right ? width() - boxWidth - 12 : 4;
+    p.fillRect(QRect(left, 4, boxWidth + 8, lineHeight * lines.size() + 8), QColor(255, 255, 255, 200));
+    p.setPen(Qt::black);
+    for (int i = 0; i < lines.size(); i++) {
+        p.drawText(left + 4, 8 + metrics.ascent() + i * lineHeight, lines[i]);
+    }
+}
+
+
+void GameWidget::setPerfOverlay(bool on) {
+    perfOverlay = on;
+    update();
+}
+
+
+//
+// clusters
+//
+
+void GameWidget::updateClusters() {
+    /* label the connected cells of the universe and summarize count, sizes and the largest box */
+
+    CA_TRACE_SCOPE("GameWidget", "updateClusters");
+
+    clusterLines.clear();
+    if (universeMode != 0 && universeMode != 2) {
+        clusterLines << "clusters: only for life and predator-prey";
+        return;
+    }
+
+    // life: every living cell; predator-prey: predators and prey on their own
+    const int values[] = {-1, 1, 2};
+    const QString names[] = {"cells", "predators", "prey"};
+    int first = (universeMode == 0) ? 0 : 1;
+    int last = (universeMode == 0) ? 0 : 2;
+
+    // the predator-prey universe has fixed borders, the life universe is a torus
+    clusters.setWrap(universeMode != 2);
+    CAview view = ca1.view();
+    for (int k = first; k <= last; k++) {
+        clusters.label(view, values[k]);
+
+        int largest = -1;
+        const std::vector<ClusterLabeler::component> &components = clusters.getComponents();
+        for (int c = 0; c < int(components.size()); c++) {
+            if (largest < 0 || components[c].size > components[largest].size) largest = c;
+        }
+        clusterLines << QString("%1: %2 clusters").arg(names[k]).arg(clusters.getCount());
+        if (largest >= 0) {
+            const ClusterLabeler::component &c = components[largest];
+            clusterLines << QString("  largest: %1 cells, %2 x %3 at (%4, %5)")
+                            .arg(c.size).arg(c.width).arg(c.height).arg(c.x).arg(c.y);
+        }
+
+        QString sizes;
+        const std::vector<int> &histogram = clusters.getHistogram();
+        for (int h = 0; h < int(histogram.size()); h++) {
+            if (histogram[h] > 0) sizes += QString(" %1:%2").arg(1 << h).arg(histogram[h]);
+        }
+        if (!sizes.isEmpty()) clusterLines << "  sizes" + sizes;
+    }
+}
+
+
+void GameWidget::paintClusterOverlay(QPainter &p) {
+    /* draw the cluster statistics of the current generation in the top right corner */
+
+    if (!clusterLines.isEmpty())
+        paintTextBox(p, clusterLines, true);
+}
+
+
+void GameWidget::setClusterStats(bool on) {
+    clusterStats = on;
+    if (on)
+        updateClusters();
+    update();
+}
+
+
+//
+// frame ring
+//
+
+void GameWidget::setFramePublishing(bool on) {
+    /* publish every generation into the shared-memory frame ring for external readers */
+
+    if (!on) {
+        frames.close();
+        return;
+    }
+    if (!frames.open()) {
+        QMessageBox::warning(this, tr("Frame ring"),
+                             tr("Could not create the shared memory %1.").arg(frames.getName()));
+        return;
+    }
+    publishFrame();
+}
+
+
+void GameWidget::publishFrame() {
+    // the frame ring holds dense boards only, unbounded life is not published
+    if (frames.isOpen() && universeMode != 3)
+        frames.publish(ca1.view(), universeMode);
+    emit frameAvailable();
+}
+
+
+//
+// metrics
+//
+
+void GameWidget::sampleMetrics() {
+    /* the gauges that need a pass over the board, set when the metrics are scraped */
+
+    qint64 alive = 0;
+    int predators = 0, prey = 0, food = 0;
+    switch (universeMode) {
+    case 0:
+        alive = ca1.countLife();
+        break;
+    case 2:
+        ca1.countPredator(predators, prey, food);
+        break;
+    case 3:
+        alive = caSparse.getPopulation();
+        break;
+    default:
+        break;
+    }
+
+    MetricsRegistry &registry = MetricsRegistry::instance();
+    registry.set(metrics.alive, double(alive));
+    registry.set(metrics.predators, predators);
+    registry.set(metrics.prey, prey);
+    registry.set(metrics.food, food);
+    registry.set(metrics.snakeLength, (universeMode == 1) ? ca1.getSnakeLength() : 0);
+    registry.set(metrics.boardBytes, double(ca1.getBufferBytes()));
+    registry.set(metrics.sparseBytes, double(caSparse.getBytes()));
+    registry.set(metrics.historyBytes, double(history.getBytes()));
+}
+
+
+//
+// history
+//
+
+void GameWidget::recordHistory() {
+    /* snapshot the universe of the current mode as the newest generation of the history */
+
+    if (universeMode == 3) {
+        history.record(caSparse);
+    } else {
+        history.record(ca1);
+    }
+    historyPosition = history.size() - 1;
+    historyModified = false;
+    emit historyChanged(historyPosition, history.size());
+}
+
+
+void GameWidget::clearHistory() {
+    history.clear();
+    historyPosition = -1;
+    historyModified = false;
+    emit historyChanged(historyPosition, 0);
+}
+
+
+void GameWidget::rewindTo(int position) {
+    /* show generation position of the history, the game goes on from there when started again */
+
+    if (position < 0 || position >= history.size() || position == historyPosition)
+        return;
+
+    if (timer->isActive())
+        stopGame();
+
+    if (universeMode == 3) {
+        history.restore(position, caSparse);
+    } else {
+        history.restore(position, ca1);
+    }
+    historyPosition = position;
+    historyModified = false;
+    emit historyChanged(historyPosition, history.size());
+    publishFrame();
+    if (clusterStats)
+        updateClusters();
+    update();
+}
+
+
+void GameWidget::stepBack() {
+    rewindTo(historyPosition - 1);
+}
+
+
+void GameWidget::stepForward() {
+    rewindTo(historyPosition + 1);
+}
+
+
 QColor GameWidget::getMasterColor() {
     return masterColor;
 }
@@ -571,12 +1110,40 @@ void GameWidget::setMasterColor(const QColor &color) {
 //
 
 void GameWidget::calcDirectionSnake(int dS) {
-    /* opposing directions add up to 10 (2 + 8, 4 + 6), so past and future must NOT do so */
-    if (dS + ca1.directionSnake.past == 10) {
-        ca1.directionSnake.future = ca1.directionSnake.past; // continue with past direction if input is "invalid"
-    } else {
-        ca1.directionSnake.future = dS;
+    /* arrow key: queued for the next moves while the snake runs, applied right away otherwise */
+
+    if (universeMode != 1 || !timer->isActive()) {
+        ca1.turnSnake(dS);
+        return;
     }
+    if (snakeInput.push(dS, inputClock.nsecsElapsed(), ca1.directionSnake.past))
+        scheduleInputTick();
+}
+
+
+void GameWidget::setEarlyTick(bool on) {
+    earlyTick = on;
+    if (!on)
+        inputTimer->stop();
+}
+
+
+void GameWidget::scheduleInputTick() {
+    /* early tick for the oldest queued arrow key, at least inputTickMs after the last tick */
+
+    if (!earlyTick || turbo || autopilot || snakeInput.isEmpty() || !timer->isActive() || inputTimer->isActive())
+        return;
+    inputTimer->start(int(qMax(qint64(0), inputTickMs - tickClock.elapsed())));
+}
+
+
+void GameWidget::inputTick() {
+    // the regular ticks start over from here
+    if (!timer->isActive() || snakeInput.isEmpty())
+        return;
+    timer->start();
+    newGeneration();
+    scheduleInputTick();
 }
 
 
@@ -596,6 +1163,13 @@ void GameWidget::setSnakeAction(int a) {
 }
 
 
+void GameWidget::setAutopilot(int kind) {
+    /* let an autopilot (see SnakeAutopilot::Kind) steer instead of the arrow keys */
+    delete autopilot;
+    autopilot = SnakeAutopilot::create(kind);
+}
+
+
 void GameWidget::setPositionSnakeHead(int x, int y) {
     ca1.positionSnakeHead.x = x;
     ca1.positionSnakeHead.y = y;
@@ -608,6 +1182,29 @@ void GameWidget::setPositionFood(int x, int y) {
 }
 
 
+//
+// unbounded life
+//
+
+void GameWidget::setViewport(int x, int y) {
+    /* move the top left corner of the viewport to plane coordinates x, y */
+    viewportX = x;
+    viewportY = y;
+    update();
+}
+
+
+void GameWidget::centerViewport() {
+    /* center the viewport on the origin of the plane */
+    setViewport(-universeSize / 2, -universeSize / 2);
+}
+
+
+qint64 GameWidget::getCellsOutsideViewport() const {
+    return caSparse.countOutside(viewportX, viewportY, viewportX + universeSize - 1, viewportY + universeSize - 1);
+}
+
+
 int GameWidget::getLifetime() {
     return lifeTime;
 }
@@ -4,7 +4,19 @@
 #include <QColor>
 #include <QWidget>
 #include <QObject>
+#include <QStringList>
+#include <QElapsedTimer>
 #include "CAbase.h"
+#include "CAsparse.h"
+#include "CAhistory.h"
+#include "snakeautopilot.h"
+#include "snakeinput.h"
+#include "perfstats.h"
+#include "clusterlabeler.h"
+#include "stripcluster.h"
+#include "framepublisher.h"
+#include "metricsregistry.h"
+#include "gamefile.h"
 
 
 class GameWidget : public QWidget {
@@ -14,7 +26,14 @@ class GameWidget : public QWidget {
 public:
     explicit GameWidget(QWidget *parent = 0);
     ~GameWidget();
-    CAbase getCA();
+    CAview getView() const;
+    CAsnapshot getSnapshot() const;
+
+    bool isRunning() const;
+
+    // the board for saving and loading (see GameFile)
+    void getState(GameFile::state &s);
+    void setState(const GameFile::state &s);
 
 protected:
     void paintEvent(QPaintEvent *);
@@ -26,6 +45,8 @@ signals:
     void gameStarted(int, bool);
     void gameStopped(int, bool);
     void gameEnds(int, bool);
+    void historyChanged(int position, int count);
+    void frameAvailable();
 
 
 public slots:
@@ -45,6 +66,9 @@ public slots:
     int getInterval();
     void setInterval(int msec);
 
+    // several generations per frame, as many as a fixed time budget allows
+    void setTurbo(bool on);
+
     int getLifetime();
     void setLifetime(const int &l);
 
@@ -53,6 +77,9 @@ public slots:
 
     QColor getPredefinedColor(const int &color);
 
+    // false if the value is not a state of the current mode or x, y is outside the universe
+    bool setCell(int x, int y, int value);
+
     QString dumpGame(char member = 'v');
     void reconstructGame(const QString &data, char member = 'v');
 
@@ -65,27 +92,117 @@ public slots:
 
     void setPositionFood(int x, int y);
 
+    // UNBOUNDED LIFE
+    void setViewport(int x, int y);
+
+    void centerViewport();
+
+    // living cells of the plane that the viewport does not show (and a save would lose)
+    qint64 getCellsOutsideViewport() const;
+
     void setSnakeLength(int l);
 
     void setSnakeAction(int a);
 
+    void setAutopilot(int kind);
+
+    // move right away on an arrow key instead of waiting for the next tick
+    void setEarlyTick(bool on);
+
+    // PERFORMANCE
+    void setPerfOverlay(bool on);
+
+    // CLUSTERS
+    void setClusterStats(bool on);
+
+    // WORKER PROCESSES
+    void setStripProcesses(int n);
+
+    // FRAME RING
+    void setFramePublishing(bool on);
+
+    // METRICS
+    void sampleMetrics();
+
+    // HISTORY
+    void rewindTo(int position);
+
+    void stepBack();
+
+    void stepForward();
+
 
 private slots:
     void paintGrid(QPainter &p);
     void paintUniverse(QPainter &p);
+    void paintPerfOverlay(QPainter &p);
+    void paintClusterOverlay(QPainter &p);
+    void paintTextBox(QPainter &p, const QStringList &lines, bool right);
+    void updateClusters();
+    void startStrips();
+    void stopStrips();
+    bool stepStrips();
+    void publishFrame();
     void newGeneration();
+    void inputTick();
+    void scheduleInputTick();
+    void evolveUniverse();
+    bool isUniverseUnchanged();
     void newGenerationColor();
+    void recordHistory();
+    void clearHistory();
 
 private:
     QColor masterColor;
     QTimer *timer;
     QTimer *timerColor;
     CAbase ca1;
+    CAsparse caSparse;
+    SnakeAutopilot *autopilot;
+    int viewportX;
+    int viewportY;
+    QPoint panOrigin;
     int universeSize;
     int universeMode;
     int cellMode;
     int lifeTime;
     int generations;
+    PerfStats perf;
+    bool perfOverlay;
+    ClusterLabeler clusters;
+    bool clusterStats;
+    QStringList clusterLines;
+    StripCluster *strips;
+    int stripProcesses;
+    QElapsedTimer frameClock;
+    FramePublisher frames;
+    struct {
+        int generations;
+        int step;
+        int paint;
+        int alive;
+        int predators;
+        int prey;
+        int food;
+        int snakeLength;
+        int boardBytes;
+        int sparseBytes;
+        int historyBytes;
+        int inputLatency;
+    } metrics; // ids in the MetricsRegistry
+    CAhistory history;
+    int historyPosition;
+    bool historyModified;
+    int interval;          // ms between two generations, unless in turbo mode
+    bool turbo;
+    qint64 turboStepCost;  // ns, moving average of one generation
+    int turboBatch;        // generations of the last tick
+    SnakeInputQueue snakeInput;
+    QElapsedTimer inputClock;      // time of the key presses in snakeInput
+    QElapsedTimer tickClock;       // since the last tick
+    PerfHistogram inputLatency;    // ns from an arrow key to the move applying it
+    QTimer *inputTimer;            // early tick after an arrow key
+    bool earlyTick;
 };
 
 
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <vector>
+
+#include "gifencoder.h"
+
+
+static void appendUInt16(QByteArray &out, int v) {
+    out.append(char(v & 0xff));
+    out.append(char((v >> 8) & 0xff));
+}
+
+
+class GifBitWriter {
+    /* LSB-first variable-length codes, packed into data sub-blocks of up to 255 bytes */
+
+public:
+    explicit GifBitWriter(QByteArray &out) :
+        out(out),
+        bits(0),
+        bitCount(0),
+        blockLength(0)
+        {}
+
+    void write(int code, int size) {
+        bits |= quint32(code) << bitCount;
+        bitCount += size;
+        while (bitCount >= 8) {
+            put(char(bits & 0xff));
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    void finish() {
+        if (bitCount > 0) put(char(bits & 0xff));
+        flushBlock();
+        out.append(char(0)); // block terminator
+    }
+
+private:
+    void put(char c) {
+        block[blockLength++] = c;
+        if (blockLength == 255) flushBlock();
+    }
+
+    void flushBlock() {
+        if (blockLength == 0) return;
+        out.append(char(blockLength));
+        out.append(block, blockLength);
+        blockLength = 0;
+    }
+
+    QByteArray &out;
+    quint32 bits;
+    int bitCount;
+    char block[255];
+    int blockLength;
+};
+
+
+QByteArray GifEncoder::header(int width, int height, const quint32 *palette, int colorBits) {
+    /* signature, logical screen descriptor, global color table and the NETSCAPE loop extension */
+
+    QByteArray out("GIF89a");
+    appendUInt16(out, width);
+    appendUInt16(out, height);
+    out.append(char(0x80 | ((colorBits - 1) << 4) | (colorBits - 1))); // global table of 2^colorBits
+    out.append(char(0)); // background color
+    out.append(char(0)); // no aspect ratio
+    for (int i = 0; i < (1 << colorBits); i++) {
+        out.append(char((palette[i] >> 16) & 0xff));
+        out.append(char((palette[i] >> 8) & 0xff));
+        out.append(char(palette[i] & 0xff));
+    }
+
+    out.append("\x21\xff\x0bNETSCAPE2.0\x03\x01", 16);
+    appendUInt16(out, 0); // loop forever
+    out.append(char(0));
+    return out;
+}
+
+
+QByteArray GifEncoder::frame(const uchar *pixels, int width, int height, int stride, int delay, int colorBits) {
+    /* graphic control extension (delay), image descriptor and the LZW image data */
+
+    QByteArray out;
+    out.append("\x21\xf9\x04\x04", 4); // graphic control, disposal: leave in place
+    appendUInt16(out, delay);
+    out.append(char(0)); // no transparent color
+    out.append(char(0));
+
+    out.append(char(0x2c));
+    appendUInt16(out, 0);
+    appendUInt16(out, 0);
+    appendUInt16(out, width);
+    appendUInt16(out, height);
+    out.append(char(0)); // no local color table, not interlaced
+
+    int minCodeSize = colorBits < 2 ? 2 : colorBits;
+    out.append(char(minCodeSize));
+    compress(pixels, width, height, stride, minCodeSize, out);
+    return out;
+}
+
+
+void GifEncoder::compress(const uchar *pixels, int width, int height, int stride, int minCodeSize, QByteArray &out) {
+    /* LZW over the rows with a trie of child codes per (code, pixel)
+     *
+     * The code size grows when the next free code needs one more bit; once all 4096
+     * codes are taken a clear code starts a fresh table. The stream ends with a clear
+     * code so that the end code is read at the initial size whatever the decoder's
+     * table looks like.
+     */
+
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+    const int alphabet = 1 << minCodeSize;
+
+    std::vector<quint16> child(size_t(4096) * alphabet, 0); // 0: no child (codes below endCode are never children)
+    GifBitWriter writer(out);
+    int codeSize = minCodeSize + 1;
+    int maxCode = endCode;
+    int current = -1;
+
+    writer.write(clearCode, codeSize);
+    for (int y = 0; y < height; y++) {
+        const uchar *row = pixels + size_t(y) * stride;
+        for (int x = 0; x < width; x++) {
+            int pixel = row[x] & (alphabet - 1);
+            if (current < 0) {
+                current = pixel;
+                continue;
+            }
+            quint16 &next = child[size_t(current) * alphabet + pixel];
+            if (next) {
+                current = next;
+                continue;
+            }
+
+            writer.write(current, codeSize);
+            next = quint16(++maxCode);
+            if (maxCode >= (1 << codeSize)) codeSize++;
+            if (maxCode == 4095) {
+                writer.write(clearCode, codeSize);
+                std::fill(child.begin(), child.end(), 0);
+                codeSize = minCodeSize + 1;
+                maxCode = endCode;
+            }
+            current = pixel;
+        }
+    }
+
+    if (current >= 0) {
+        writer.write(current, codeSize);
+        // a decoder adds one more entry after this code and may widen its codes for the clear
+        if (maxCode + 1 >= (1 << codeSize) && codeSize < 12) codeSize++;
+    }
+    writer.write(clearCode, codeSize);
+    writer.write(endCode, minCodeSize + 1);
+    writer.finish();
+}
@@ -0,0 +1,32 @@
+#ifndef GIFENCODER_H
+#define GIFENCODER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+class GifEncoder {
+    /* animated GIF89a writer for palette-indexed frames
+     *
+     * A file is header(), then frame() for every frame in order, then trailer(). Every
+     * frame carries its own delay and LZW stream and depends on nothing before it, so
+     * frames can be encoded on several threads and concatenated afterwards.
+     */
+
+public:
+    static const int maxColorBits = 8;
+
+    // logical screen, global palette of 2^colorBits 0xAARRGGBB colors, endless loop
+    static QByteArray header(int width, int height, const quint32 *palette, int colorBits);
+
+    // one full-screen frame of palette indices below 2^colorBits, delay in 1/100 s
+    static QByteArray frame(const uchar *pixels, int width, int height, int stride, int delay, int colorBits);
+
+    static QByteArray trailer() {
+        return QByteArray(1, ';');
+    }
+
+private:
+    static void compress(const uchar *pixels, int width, int height, int stride, int minCodeSize, QByteArray &out);
+};
+
+#endif // GIFENCODER_H
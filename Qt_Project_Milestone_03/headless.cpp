@@ -0,0 +1,480 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+
+#include "headless.h"
+#include "caframereader.h"
+#include "ensemblerunner.h"
+#include "frameexporter.h"
+#include "framepublisher.h"
+#include "gifencoder.h"
+#include "snakeautopilot.h"
+#include "snakeselfplay.h"
+#include "soupcensus.h"
+#include "stripcluster.h"
+
+
+static const char *headlessModes[] = {"--ensemble", "--selfplay", "--soup", "--strips", "--strip-worker", "--export",
+                                     "--frame-ring-test", "--gif-test"};
+
+
+bool isHeadlessRun(int argc, char *argv[]) {
+    /* headless if one of the mode options is given, as --mode value or --mode=value like the parser takes it */
+
+    for (int i = 1; i < argc; i++) {
+        QString option = QString(argv[i]).section('=', 0, 0);
+        for (const char *mode : headlessModes) {
+            if (option == mode) return true;
+        }
+    }
+    return false;
+}
+
+
+static int runEnsemble(const QCommandLineParser &parser) {
+    /* Predator ensemble: runs x densities x lifetimes simulations, mean/variance curves to CSV */
+
+    QTextStream out(stdout);
+    EnsembleRunner runner(parser.value("size").toInt(), parser.value("generations").toInt());
+    runner.setRunsPerPoint(parser.value("runs").toInt());
+    runner.setBaseSeed(parser.value("seed").toUInt());
+    runner.setThreads(parser.value("threads").toInt());
+    for (const QString &d : parser.value("densities").split(',')) {
+        runner.addDensity(d.toDouble());
+    }
+    for (const QString &l : parser.value("lifetimes").split(',')) {
+        runner.addLifetime(l.toInt());
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    runner.run();
+    double seconds = timer.nsecsElapsed() / 1e9;
+
+    if (!runner.writeCsv(parser.value("ensemble"))) {
+        out << "could not write " << parser.value("ensemble") << "\n";
+        return 1;
+    }
+    out << runner.getRunCount() << " runs in " << seconds << " s ("
+        << runner.getRunCount() / seconds << " runs/s)\n";
+    return 0;
+}
+
+
+static int runSelfPlay(const QCommandLineParser &parser) {
+    /* snake self-play: games/s, mean length and steps per food of one autopilot */
+
+    QTextStream out(stdout);
+    const QStringList pilots = {"off", "greedy", "bfs", "hamiltonian"};
+    int autopilot = pilots.indexOf(parser.value("autopilot"));
+    if (autopilot <= SnakeAutopilot::Off) {
+        out << "unknown autopilot " << parser.value("autopilot") << " (greedy, bfs, hamiltonian)\n";
+        return 1;
+    }
+
+    SnakeSelfPlay selfPlay(parser.value("size").toInt(), autopilot);
+    selfPlay.setThreads(parser.value("threads").toInt());
+    selfPlay.setBaseSeed(parser.value("seed").toUInt());
+    selfPlay.run(parser.value("selfplay").toInt());
+
+    const SnakeSelfPlay::results &r = selfPlay.getResults();
+    out << r.games << " games in " << r.seconds << " s (" << r.games / r.seconds << " games/s)\n"
+        << "mean length: " << double(r.lengthSum) / r.games << "\n"
+        << "steps per food: " << (r.food ? double(r.steps) / r.food : 0.0) << "\n"
+        << "boards filled: " << r.wins << "\n";
+    return 0;
+}
+
+
+static int runSoupCensus(const QCommandLineParser &parser) {
+    /* random Life soups: census of the objects they settle into, to CSV */
+
+    QTextStream out(stdout);
+    int soupSize = parser.value("soup-size").toInt();
+    int size = parser.isSet("size") ? parser.value("size").toInt() : 128;
+    if (size < soupSize) {
+        out << "universe size " << size << " is smaller than the soup size " << soupSize << "\n";
+        return 1;
+    }
+
+    SoupCensus census(size, soupSize, parser.value("density").toDouble());
+    census.setThreads(parser.value("threads").toInt());
+    census.setBaseSeed(parser.value("seed").toUInt());
+    if (parser.isSet("generations"))
+        census.setMaxGenerations(parser.value("generations").toInt());
+    census.run(parser.value("soups").toInt());
+
+    if (!census.writeCsv(parser.value("soup"))) {
+        out << "could not write " << parser.value("soup") << "\n";
+        return 1;
+    }
+    const SoupCensus::results &r = census.getResults();
+    out << r.soups << " soups in " << r.seconds << " s (" << r.soups / r.seconds << " soups/s, "
+        << r.soups / r.seconds / r.threads << " soups/s per core)\n"
+        << "settled: " << r.settled << "\n"
+        << "distinct objects: " << census.getCensus().size() << "\n";
+    return 0;
+}
+
+
+static int runStrips(const QCommandLineParser &parser) {
+    /* Life on worker processes: generations/s of a random board split into strips */
+
+    QTextStream out(stdout);
+    int size = parser.isSet("size") ? parser.value("size").toInt() : 1024;
+    int generations = parser.value("generations").toInt();
+
+    CAbase board(size, size);
+    board.setSeed(parser.value("seed").toUInt());
+    board.putRandomSoup(1, 1, size, size, parser.value("density").toDouble());
+
+    StripCluster cluster(size, size, parser.value("strips").toInt());
+    if (!cluster.start() || !cluster.load(board.view())) {
+        out << cluster.errorString() << "\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    bool stepped = cluster.step(generations);
+    double seconds = timer.nsecsElapsed() / 1e9;
+    if (!stepped || !cluster.gather(board)) {
+        out << cluster.errorString() << "\n";
+        return 1;
+    }
+
+    out << generations << " generations of " << size << " x " << size << " on " << cluster.getStrips()
+        << " processes in " << seconds << " s (" << generations / seconds << " generations/s, "
+        << double(size) * size * generations / seconds / 1e6 << " M cells/s)\n"
+        << "living cells: " << board.countLife() << "\n";
+    return 0;
+}
+
+
+static int runExport(const QCommandLineParser &parser) {
+    /* offscreen movie: step a board and encode every generation on worker threads */
+
+    QTextStream out(stdout);
+    const QStringList modes = {"life", "snake", "predator"};
+    int mode = modes.indexOf(parser.value("mode"));
+    if (mode < 0) {
+        out << "unknown mode " << parser.value("mode") << " (life, snake, predator)\n";
+        return 1;
+    }
+    const QStringList pilots = {"off", "greedy", "bfs", "hamiltonian"};
+    std::unique_ptr<SnakeAutopilot> pilot(SnakeAutopilot::create(pilots.indexOf(parser.value("autopilot"))));
+    if (mode == 1 && !pilot) {
+        out << "snake export needs an autopilot (greedy, bfs, hamiltonian)\n";
+        return 1;
+    }
+
+    int size = parser.value("size").toInt();
+    int generations = parser.value("generations").toInt();
+    CAbase board(size, size);
+    board.setSeed(parser.value("seed").toUInt());
+    if (mode == 0) {
+        board.putRandomSoup(1, 1, size, size, parser.value("density").toDouble());
+    } else if (mode == 1) {
+        board.putInitSnake();
+        board.putNewFood();
+    } else {
+        board.lifeTimeUI = parser.value("lifetimes").split(',').first().toInt();
+        board.putRandomPredator(parser.value("density").toDouble(), board.lifeTimeUI);
+    }
+
+    QString path = parser.value("export");
+    FrameExporter exporter(path, path.endsWith(".gif", Qt::CaseInsensitive) ? FrameExporter::Gif : FrameExporter::Png,
+                           parser.value("scale").toInt());
+    exporter.setThreads(parser.value("threads").toInt());
+    exporter.setDelay(parser.value("delay").toInt());
+    if (!exporter.start(size, size)) {
+        out << exporter.errorString() << "\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int frames = 0;
+    for (int g = 0; g <= generations; g++) {
+        if (g > 0) {
+            if (board.isNotChanged()) break;
+            if (mode == 0) {
+                board.worldEvolutionLife();
+            } else if (mode == 1) {
+                board.turnSnake(pilot->nextDirection(SnakeView::of(board)));
+                board.worldEvolutionSnake();
+            } else {
+                board.worldEvolutionPredator();
+            }
+        }
+        if (!exporter.addFrame(board.view(), mode)) break;
+        frames++;
+    }
+    bool ok = exporter.finish();
+    double seconds = timer.nsecsElapsed() / 1e9;
+    if (!ok) {
+        out << exporter.errorString() << "\n";
+        return 1;
+    }
+
+    out << frames << " frames to " << path << " in " << seconds << " s (" << frames / seconds << " frames/s on "
+        << exporter.getThreadCount() << " threads, " << exporter.getBytesWritten() / 1024 << " KiB)\n";
+    return 0;
+}
+
+
+static int runFrameRingTest(const QCommandLineParser &parser) {
+    /* frame ring self test: a writer thread publishes boards, the C reader checks every frame it gets
+     *
+     * Every cell of frame f holds the same state and lifetime, and the board size changes
+     * from frame to frame, so a frame mixed from two writes shows up as a cell that differs
+     * from the first one. Both the copying read and the zero-copy view (once validated)
+     * are checked. Exits with 1 if a torn frame was accepted.
+     */
+
+    QTextStream out(stdout);
+    const int frames = parser.value("frame-ring-test").toInt();
+    const int size = parser.isSet("size") ? parser.value("size").toInt() : 256;
+    const QString name = QString("/ca-frames-test-%1").arg(QCoreApplication::applicationPid());
+
+    FramePublisher publisher(name);
+    if (size < 2 || !publisher.open(size * size, 3)) {
+        out << "could not create the frame ring " << name << "\n";
+        return 1;
+    }
+    ca_frame_reader *reader = ca_frame_reader_open(name.toLocal8Bit().constData());
+    if (!reader) {
+        out << "could not open the frame ring " << name << "\n";
+        return 1;
+    }
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        CAbase board(size, size);
+        for (int f = 1; f <= frames; f++) {
+            int n = size / 2 + f % (size / 2 + 1);
+            int v = 1 + f % 1000;
+            board.resetWorldSize(n, n);
+            for (int y = 1; y <= n; y++) {
+                for (int x = 1; x <= n; x++) {
+                    board.setValue(x, y, v);
+                    board.setLifetime(x, y, v);
+                }
+            }
+            publisher.publish(board.view(), 0);
+        }
+        done = true;
+    });
+
+    std::vector<int16_t> world(size_t(size) * size), lifetime(world.size());
+    qint64 copies = 0, views = 0, torn = 0;
+    while (!done) {
+        ca_frame_view view;
+        if (ca_frame_reader_copy(reader, &view, world.data(), lifetime.data(), world.size()) == 0) {
+            size_t cells = size_t(view.nx) * view.ny;
+            bool ok = view.nx == view.ny;
+            for (size_t i = 0; ok && i < cells; i++) {
+                ok = world[i] == world[0] && lifetime[i] == world[0];
+            }
+            if (!ok) torn++;
+            copies++;
+        }
+
+        if (ca_frame_reader_latest(reader, &view) == 0) {
+            size_t cells = size_t(view.nx) * view.ny;
+            bool ok = view.nx == view.ny;
+            for (size_t i = 0; ok && i < cells; i++) {
+                ok = view.world[i] == view.world[0] && view.lifetime[i] == view.world[0];
+            }
+            // a view the writer has reused in the meantime is thrown away, as its readers must do
+            if (ca_frame_view_valid(&view)) {
+                if (!ok) torn++;
+                views++;
+            }
+        }
+    }
+    writer.join();
+    quint64 published = ca_frame_reader_published(reader);
+    ca_frame_reader_close(reader);
+
+    out << published << " frames published, " << copies << " copies and " << views
+        << " zero-copy views read, " << torn << " torn\n";
+    return (torn == 0 && published == quint64(frames)) ? 0 : 1;
+}
+
+
+static bool decodeGifFrame(const QByteArray &frame, std::vector<uchar> &pixels) {
+    /* strict LZW decoder of one GifEncoder::frame: false on any code a GIF decoder must reject */
+
+    // graphic control extension (8 bytes), image descriptor (10 bytes), minimum code size
+    const uchar *data = reinterpret_cast<const uchar*>(frame.constData());
+    int size = frame.size();
+    int p = 18;
+    if (size < p + 1 || data[0] != 0x21 || data[8] != 0x2c) return false;
+    int minCodeSize = data[p++];
+    if (minCodeSize < 2 || minCodeSize > 8) return false;
+
+    std::vector<uchar> stream;
+    while (p < size && data[p] != 0) {
+        int length = data[p++];
+        if (p + length > size) return false;
+        stream.insert(stream.end(), data + p, data + p + length);
+        p += length;
+    }
+    if (p != size - 1) return false;
+
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+    std::vector<int> prefix(4096), suffix(4096), first(4096);
+    std::vector<uchar> entry;
+    int codeSize = minCodeSize + 1;
+    int next = endCode + 1;
+    int previous = -1;
+    qint64 bit = 0;
+    pixels.clear();
+
+    for (;;) {
+        if (bit + codeSize > qint64(stream.size()) * 8) return false;
+        int code = 0;
+        for (int i = 0; i < codeSize; i++, bit++) {
+            code |= ((stream[size_t(bit >> 3)] >> (bit & 7)) & 1) << i;
+        }
+
+        if (code == clearCode) {
+            codeSize = minCodeSize + 1;
+            next = endCode + 1;
+            previous = -1;
+            continue;
+        }
+        if (code == endCode) return true;
+        if (code > next || (code == next && previous < 0)) return false;
+        if (code < clearCode) first[code] = code;
+
+        // the entry of code, backwards; code == next is the previous entry plus its first pixel
+        entry.clear();
+        int c = code;
+        if (code == next) {
+            entry.push_back(uchar(first[previous]));
+            c = previous;
+        }
+        while (c >= clearCode) {
+            entry.push_back(uchar(suffix[c]));
+            c = prefix[c];
+        }
+        entry.push_back(uchar(c));
+        pixels.insert(pixels.end(), entry.rbegin(), entry.rend());
+
+        if (previous >= 0 && next < 4096) {
+            prefix[next] = previous;
+            suffix[next] = entry.back();
+            first[next] = first[previous];
+            next++;
+            if (next == (1 << codeSize) && codeSize < 12) codeSize++;
+        }
+        previous = code;
+    }
+}
+
+
+static int runGifTest(const QCommandLineParser &parser) {
+    /* GIF encoder self test: random frames through GifEncoder and back through a strict LZW decoder
+     *
+     * The frames vary in size, palette size and noise, from long runs that fill the code
+     * table to pixels that barely compress. Exits with 1 if a frame does not decode to
+     * its pixels.
+     */
+
+    QTextStream out(stdout);
+    const int frames = parser.value("gif-test").toInt();
+    quint32 random = parser.value("seed").toUInt();
+    auto nextRandom = [&random]() {
+        random = random * 1103515245u + 12345u;
+        return int(random >> 8);
+    };
+
+    std::vector<uchar> pixels, decoded;
+    int failed = 0;
+    for (int f = 0; f < frames; f++) {
+        int width = 1 + nextRandom() % 96;
+        int height = 1 + nextRandom() % 96;
+        int colorBits = 1 + nextRandom() % GifEncoder::maxColorBits;
+        int noise = 1 + nextRandom() % 64; // one pixel in noise changes the color
+        pixels.resize(size_t(width) * height);
+        int color = 0;
+        for (uchar &pixel : pixels) {
+            if (nextRandom() % noise == 0) color = nextRandom() % (1 << colorBits);
+            pixel = uchar(color);
+        }
+
+        QByteArray frame = GifEncoder::frame(pixels.data(), width, height, width, 4, colorBits);
+        if (!decodeGifFrame(frame, decoded) || decoded != pixels) {
+            if (failed++ < 10)
+                out << "frame " << f << " (" << width << " x " << height << ", " << colorBits << " bits) does not decode\n";
+        }
+    }
+
+    out << frames << " frames encoded and decoded, " << failed << " failed\n";
+    return failed == 0 ? 0 : 1;
+}
+
+
+int runHeadless(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Cellular automata, headless modes");
+    parser.addHelpOption();
+
+    parser.addOptions({
+        {"ensemble", "Run a Predator ensemble and write the population curves to <csv>.", "csv"},
+        {"size", "Universe size (soups: default 128).", "n", "64"},
+        {"generations", "Generations per run (soups: at most, default 10000).", "n", "500"},
+        {"runs", "Runs per parameter point.", "n", "100"},
+        {"densities", "Comma separated initial densities.", "list", "0.3"},
+        {"lifetimes", "Comma separated predator/prey lifetimes.", "list", "50"},
+        {"seed", "Seed of the first run.", "n", "1"},
+        {"threads", "Worker threads (0: one per core).", "n", "0"},
+        {"selfplay", "Play <games> snake games with an autopilot.", "games"},
+        {"autopilot", "Snake autopilot: greedy, bfs or hamiltonian.", "name", "bfs"},
+        {"soup", "Run random Life soups and write the object census to <csv>.", "csv"},
+        {"soups", "Number of soups.", "n", "1000"},
+        {"soup-size", "Side of the random square.", "n", "16"},
+        {"density", "Probability of a living cell in the soup.", "p", "0.5"},
+        {"strips", "Run Life on <n> worker processes (horizontal strips, size default 1024).", "n"},
+        {"strip-worker", "Internal: worker process of the shared region <name>.", "name"},
+        {"strip", "Internal: strip of a worker process.", "n", "0"},
+        {"export", "Write every generation as <path>.gif or as PNG files into the directory <path>.", "path"},
+        {"mode", "Universe of the export: life, snake (with --autopilot) or predator.", "name", "life"},
+        {"scale", "Pixels per cell of the export.", "n", "4"},
+        {"delay", "Time a GIF frame is shown, 1/100 s.", "n", "4"},
+        {"frame-ring-test", "Publish <frames> frames and check them with the C reader (size default 256).", "frames"},
+        {"gif-test", "Encode <frames> random GIF frames and decode them again (with --seed).", "frames"},
+    });
+    parser.process(app);
+
+    if (parser.isSet("strip-worker"))
+        return StripCluster::runWorker(parser.value("strip-worker"), parser.value("strip").toInt());
+
+    if (parser.isSet("ensemble"))
+        return runEnsemble(parser);
+    if (parser.isSet("selfplay"))
+        return runSelfPlay(parser);
+    if (parser.isSet("soup"))
+        return runSoupCensus(parser);
+    if (parser.isSet("strips"))
+        return runStrips(parser);
+    if (parser.isSet("export"))
+        return runExport(parser);
+    if (parser.isSet("frame-ring-test"))
+        return runFrameRingTest(parser);
+    if (parser.isSet("gif-test"))
+        return runGifTest(parser);
+
+    parser.showHelp(1);
+    return 1;
+}
@@ -0,0 +1,10 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+/* command line modes that run without a window */
+
+bool isHeadlessRun(int argc, char *argv[]);
+
+int runHeadless(int argc, char *argv[]);
+
+#endif // HEADLESS_H
@@ -11,7 +11,7 @@ bool KeyPressFilter::eventFilter(QObject *watched, QEvent *event) {
         QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
         int key = keyEvent->key();
 
-        /* act when one of the relevant keys 2, 4, 6, 8 is pressed */
+        /* act when one of the relevant keys 2, 4, 6, 8 is pressed, other keys go on to the widgets */
         if (key == Qt::Key_Down) {
             emit keyPressed(2);
         } else if (key == Qt::Key_Up) {
@@ -20,6 +20,8 @@ bool KeyPressFilter::eventFilter(QObject *watched, QEvent *event) {
             emit keyPressed(4);
         } else if (key == Qt::Key_Right) {
             emit keyPressed(6);
+        } else {
+            return QObject::eventFilter(watched, event);
         }
         return true;
     } else {
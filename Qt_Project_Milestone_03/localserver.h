@@ -0,0 +1,14 @@
+#ifndef LOCALSERVER_H
+#define LOCALSERVER_H
+
+#include <QLocalServer>
+#include <QString>
+
+// listen on the local socket name (a path or a name in the runtime directory);
+// a socket file left behind by a crashed instance would make listen fail, so it is removed first
+inline bool listenLocal(QLocalServer *server, const QString &name) {
+    QLocalServer::removeServer(name);
+    return server->listen(name);
+}
+
+#endif // LOCALSERVER_H
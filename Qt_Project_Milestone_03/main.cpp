@@ -1,8 +1,12 @@
 #include <QApplication>
 #include "mainwindow.h"
+#include "headless.h"
 
 int main(int argc, char *argv[])
 {
+    if (isHeadlessRun(argc, argv))
+        return runHeadless(argc, argv);
+
     QApplication CA_apps(argc, argv);
     MainWindow w;
     w.show();
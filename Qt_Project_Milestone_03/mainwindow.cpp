@@ -4,18 +4,25 @@
 #include <QColor>
 #include <QMessageBox>
 #include <QColorDialog>
+#include <QCoreApplication>
+#include <QStringList>
+#include <QStatusBar>
 #include <ctime>
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "keypressfilter.h"
+#include "tracerecorder.h"
 
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
     currentColor(QColor(0, 0, 0)),
-    game(new GameWidget(this))
+    game(new GameWidget(this)),
+    control(0),
+    metrics(0),
+    gameFile(new GameFile(this))
 {
     ui->setupUi(this);
 
@@ -23,6 +30,13 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->universeModeControl->addItem("Game of Life");
     ui->universeModeControl->addItem("Snake");
     ui->universeModeControl->addItem("Predator");
+    ui->universeModeControl->addItem("Unbounded Life");
+
+    /* snake autopilots, in the order of SnakeAutopilot::Kind */
+    ui->autopilotControl->addItem("Off");
+    ui->autopilotControl->addItem("Greedy");
+    ui->autopilotControl->addItem("Shortest path");
+    ui->autopilotControl->addItem("Hamiltonian cycle");
 
     /* color icons for color buttons */
     QPixmap icon(16, 16);
@@ -36,13 +50,17 @@ MainWindow::MainWindow(QWidget *parent) :
 
     /* spin boxes */
     connect(ui->intervalControl, SIGNAL(valueChanged(int)), game, SLOT(setInterval(int)));
+    connect(ui->turboControl, SIGNAL(toggled(bool)), game, SLOT(setTurbo(bool)));
     connect(ui->universeSizeControl, SIGNAL(valueChanged(int)), game, SLOT(setUniverseSize(int)));
     connect(ui->lifetimeControl, SIGNAL(valueChanged(int)), game, SLOT(setLifetime(int)));
+    connect(ui->stripProcessesControl, SIGNAL(valueChanged(int)), game, SLOT(setStripProcesses(int)));
 
     /* combo boxes */
     connect(ui->universeModeControl, SIGNAL(currentIndexChanged(int)), game, SLOT(setUniverseMode(int)));
     connect(ui->universeModeControl, SIGNAL(currentIndexChanged(int)), this, SLOT(globalButtonControl(int)));
     connect(ui->cellModeControl, SIGNAL(currentIndexChanged(int)), game, SLOT(setCellMode(int)));
+    connect(ui->autopilotControl, SIGNAL(currentIndexChanged(int)), game, SLOT(setAutopilot(int)));
+    connect(ui->earlyTickControl, SIGNAL(toggled(bool)), game, SLOT(setEarlyTick(bool)));
 
     /* enable/disable interaction during the game */
     connect(game, SIGNAL(gameStarted(int, bool)), this, SLOT(disableControls(int, bool)));
@@ -57,6 +75,24 @@ MainWindow::MainWindow(QWidget *parent) :
     /* load/save game */
     connect(ui->saveButton, SIGNAL(clicked()), this, SLOT(saveGame()));
     connect(ui->loadButton, SIGNAL(clicked()), this, SLOT(loadGame()));
+    connect(gameFile, SIGNAL(progress(int)), this, SLOT(showFileProgress(int)));
+    connect(gameFile, SIGNAL(saved(bool)), this, SLOT(gameSaved(bool)));
+    connect(gameFile, SIGNAL(loaded(bool)), this, SLOT(gameLoaded(bool)));
+
+    /* performance overlay */
+    connect(ui->perfOverlayControl, SIGNAL(toggled(bool)), game, SLOT(setPerfOverlay(bool)));
+    connect(ui->clusterStatsControl, SIGNAL(toggled(bool)), game, SLOT(setClusterStats(bool)));
+    connect(ui->framePublishControl, SIGNAL(toggled(bool)), game, SLOT(setFramePublishing(bool)));
+
+    /* timeline recording */
+    connect(ui->traceRecordControl, SIGNAL(toggled(bool)), this, SLOT(setTraceRecording(bool)));
+    connect(ui->traceSaveButton, SIGNAL(clicked()), this, SLOT(saveTrace()));
+
+    /* history */
+    connect(ui->stepBackButton, SIGNAL(clicked()), game, SLOT(stepBack()));
+    connect(ui->stepForwardButton, SIGNAL(clicked()), game, SLOT(stepForward()));
+    connect(ui->historySlider, SIGNAL(valueChanged(int)), game, SLOT(rewindTo(int)));
+    connect(game, SIGNAL(historyChanged(int, int)), this, SLOT(updateHistory(int, int)));
 
     /* stretch layout for better looks */
     ui->mainLayout->setStretchFactor(ui->gameLayout, 8);
@@ -67,6 +103,41 @@ MainWindow::MainWindow(QWidget *parent) :
 
     globalButtonControl(game->getUniverseMode());
 
+    /* remote control over a local socket, "--control <name>" */
+    QStringList arguments = QCoreApplication::arguments();
+    int controlIndex = arguments.indexOf("--control");
+    if (controlIndex > 0 && controlIndex + 1 < arguments.size()) {
+        control = new ControlServer(game, this);
+        if (control->listen(arguments[controlIndex + 1])) {
+            connect(control, SIGNAL(startRequested(int)), game, SLOT(startGame(int)));
+            connect(control, SIGNAL(stopRequested()), game, SLOT(stopGame()));
+            connect(control, SIGNAL(clearRequested()), game, SLOT(clearGame()));
+            // interval and mode go through the controls so that the window shows them
+            connect(control, SIGNAL(intervalRequested(int)), ui->intervalControl, SLOT(setValue(int)));
+            connect(control, SIGNAL(modeRequested(int)), ui->universeModeControl, SLOT(setCurrentIndex(int)));
+            connect(game, SIGNAL(frameAvailable()), control, SLOT(publishFrame()));
+        } else {
+            QMessageBox::warning(this, tr("Remote control"), tr("Cannot listen on %1: %2")
+                                 .arg(arguments[controlIndex + 1]).arg(control->errorString()));
+        }
+    }
+
+    /* Prometheus metrics, "--metrics <name>" on a local socket, "--metrics-file <path>" as a file */
+    int metricsIndex = arguments.indexOf("--metrics");
+    int metricsFileIndex = arguments.indexOf("--metrics-file");
+    if ((metricsIndex > 0 && metricsIndex + 1 < arguments.size()) ||
+            (metricsFileIndex > 0 && metricsFileIndex + 1 < arguments.size())) {
+        metrics = new MetricsExporter(this);
+        connect(metrics, SIGNAL(scrapeRequested()), game, SLOT(sampleMetrics()));
+        if (metricsIndex > 0 && metricsIndex + 1 < arguments.size() && !metrics->listen(arguments[metricsIndex + 1])) {
+            QMessageBox::warning(this, tr("Metrics"), tr("Cannot listen on %1: %2")
+                                 .arg(arguments[metricsIndex + 1]).arg(metrics->errorString()));
+        }
+        if (metricsFileIndex > 0 && metricsFileIndex + 1 < arguments.size() && !metrics->dumpTo(arguments[metricsFileIndex + 1])) {
+            QMessageBox::warning(this, tr("Metrics"), tr("Cannot write %1.").arg(arguments[metricsFileIndex + 1]));
+        }
+    }
+
     /* send keystrokes to snake game */
     KeyPressFilter *keyPressFilter = new KeyPressFilter(this->game);
     this->installEventFilter(keyPressFilter);
@@ -80,7 +151,10 @@ MainWindow::~MainWindow() {
 
 
 void MainWindow::globalButtonControl(int uM) {
-    if (uM < 2) {
+    ui->autopilotControl->setEnabled(uM == 1);
+    ui->earlyTickControl->setEnabled(uM == 1);
+
+    if (uM != 2) {
         ui->cellModeControl->clear();
         ui->cellModeControl->setDisabled(true);
         ui->lifetimeControl->clear();
@@ -113,6 +187,7 @@ void MainWindow::enableControls(int uM, bool b) {
     ui->intervalControl->setEnabled(b);
     ui->universeSizeControl->setEnabled(b);
     ui->universeModeControl->setEnabled(b);
+    ui->stripProcessesControl->setEnabled(b);
 
     if (uM == 2) {
         ui->cellModeControl->setEnabled(true);
@@ -127,6 +202,7 @@ void MainWindow::disableControls(int uM, bool b) {
     ui->intervalControl->setDisabled(b);
     ui->universeSizeControl->setDisabled(b);
     ui->universeModeControl->setDisabled(b);
+    ui->stripProcessesControl->setDisabled(b);
 
     if (uM == 2) {
         ui->lifetimeControl->setDisabled(true);
@@ -134,147 +210,100 @@ void MainWindow::disableControls(int uM, bool b) {
 }
 
 
+void MainWindow::updateHistory(int position, int count) {
+    /* follow the generation shown by the game without sending it back through rewindTo */
+
+    ui->historySlider->blockSignals(true);
+    ui->historySlider->setRange(0, qMax(count - 1, 0));
+    ui->historySlider->setValue(qMax(position, 0));
+    ui->historySlider->blockSignals(false);
+
+    ui->historySlider->setEnabled(count > 1);
+    ui->stepBackButton->setEnabled(position > 0);
+    ui->stepForwardButton->setEnabled(position >= 0 && position < count - 1);
+}
+
+
 void MainWindow::saveGame() {
+    /* take a copy of the game here, format and write it in the background (see GameFile) */
+
     int uM = game->getUniverseMode();
-    QString filename, size, buffer;
-    QColor color;
-    QFile file;
+    QString filename;
+
+    if (gameFile->isBusy()) {
+        QMessageBox::information(this, tr("File Not Saved"), tr("A game is still being saved or loaded."));
+        return;
+    }
+
+    // a file holds one square of the unbounded plane, the viewport
+    qint64 outside = (uM == 3) ? game->getCellsOutsideViewport() : 0;
+    if (outside > 0 &&
+            QMessageBox::warning(this, tr("Save Viewport Only"),
+                                 tr("%1 living cells lie outside the viewport and will not be saved. Save anyway?").arg(outside),
+                                 QMessageBox::Save | QMessageBox::Cancel) != QMessageBox::Save) {
+        return;
+    }
 
     switch (uM) {
 
-    // GAME OF LIFE
+    // GAME OF LIFE (the unbounded plane is saved as seen through the viewport)
     case 0:
-
+    case 3:
         filename = QFileDialog::getSaveFileName(this, tr("Save current game"),
                                                 QDir::homePath(), tr("Game of Life *.game Files (*.game_of_life)"));
-        if (filename.length() < 1)
-            return;
-
-        file.setFileName(filename);
-
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            QMessageBox::warning(this,
-                                 tr("File Not Saved"),
-                                 tr("For some reason the game could not be written to the chosen file."),
-                                 QMessageBox::Ok);
-            return;
-        }
-
-        size = QString::number(game->getUniverseSize()) + "\n";
-        file.write(size.toUtf8());
-        file.write(game->dumpGame().toUtf8());
-
-        color = game->getMasterColor();
-        buffer = QString::number(color.red()) + " " +
-                         QString::number(color.green()) + " " +
-                         QString::number(color.blue()) + "\n";
-        file.write(buffer.toUtf8());
-        buffer.clear();
-        buffer = QString::number(ui->intervalControl->value()) + "\n";
-        file.write(buffer.toUtf8());
-        file.close();
         break;
 
     //  SNAKE
     case 1:
         filename = QFileDialog::getSaveFileName(this, tr("Save current game"),
                                                 QDir::homePath(), tr("Snake *.snake Files (*.snake)"));
-        if (filename.length() < 1)
-            return;
-
-        file.setFileName(filename);
-
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            QMessageBox::warning(this,
-                                 tr("File Not Saved"),
-                                 tr("For some reason the game could not be written to the chosen file."),
-                                 QMessageBox::Ok);
-            return;
-        }
-
-        color = game->getMasterColor();
-
-        buffer = QString::number(game->getUniverseSize()) + "\n";
-
-        buffer += QString::number(color.red()) + " " +
-                  QString::number(color.green()) + " " +
-                  QString::number(color.blue()) + "\n";
-
-        buffer += QString::number(ui->intervalControl->value()) + "\n";
-
-        buffer += QString::number(game->getCA().directionSnake.past) + "\n" +
-                  QString::number(game->getCA().directionSnake.future) + "\n" +
-                  QString::number(game->getCA().getSnakeLength()) + "\n" +
-                  QString::number(game->getCA().getSnakeAction()) + "\n" +
-
-                  QString::number(game->getCA().positionSnakeHead.x) + " " + QString::number(game->getCA().positionSnakeHead.y) + "\n" +
-                  QString::number(game->getCA().positionFood.x) + " " + QString::number(game->getCA().positionFood.y) + "\n";
-        file.write(buffer.toUtf8());
-        buffer.clear();
-
-        file.write(game->dumpGame().toUtf8());
-        file.close();
-
         break;
 
     // PREDATOR
     case 2:
         filename = QFileDialog::getSaveFileName(this, tr("Save current game"),
                                                 QDir::homePath(), tr("Predator *.predator Files (*.predator)"));
-        if (filename.length() < 1)
-            return;
-
-        file.setFileName(filename);
-
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            QMessageBox::warning(this,
-                                 tr("File Not Saved"),
-                                 tr("For some reason the game could not be written to the chosen file."),
-                                 QMessageBox::Ok);
-            return;
-        }
-
-        color = game->getMasterColor();
-
-        buffer = QString::number(game->getUniverseSize()) + "\n";
-
-        buffer += QString::number(color.red()) + " " +
-                  QString::number(color.green()) + " " +
-                  QString::number(color.blue()) + "\n";
-
-        buffer += QString::number(ui->intervalControl->value()) + "\n";
-
-        buffer +=QString::number(ui->cellModeControl->currentIndex()) + "\n";
-
-        file.write(buffer.toUtf8());
-        buffer.clear();
-
-        file.write(game->dumpGame().toUtf8());
-
-        buffer +=QString::number(ui->lifetimeControl->value()) + "\n";
-
-        file.write(buffer.toUtf8());
-        buffer.clear();
-
-        file.write(game->dumpGame('l').toUtf8());
-
-        file.close();
+        break;
 
+    default:
         break;
     }
+
+    if (filename.length() < 1)
+        return;
+
+    GameFile::state state;
+    game->getState(state);
+    QColor color = game->getMasterColor();
+    state.red = color.red();
+    state.green = color.green();
+    state.blue = color.blue();
+    state.interval = ui->intervalControl->value();
+    state.cellMode = ui->cellModeControl->currentIndex();
+    state.lifetime = ui->lifetimeControl->value();
+
+    fileMessage = tr("Saving %1").arg(filename);
+    statusBar()->showMessage(fileMessage);
+    gameFile->save(filename, std::move(state));
 }
 
 
 void MainWindow::loadGame() {
+    /* read and parse in the background, the game is swapped in by gameLoaded */
 
     int uM = game->getUniverseMode();
     QString filename;
-    QFile file;
+
+    if (gameFile->isBusy()) {
+        QMessageBox::information(this, tr("File Not Loaded"), tr("A game is still being saved or loaded."));
+        return;
+    }
 
     switch (uM) {
 
     // GAME OF LIFE
     case 0:
+    case 3:
         filename = QFileDialog::getOpenFileName(this, tr("Open saved game"),
                                                 QDir::homePath(), tr("Game of Life File (*.game_of_life)"));
         break;
@@ -297,138 +326,100 @@ void MainWindow::loadGame() {
 
     if (filename.length() < 1)
         return;
-    file.setFileName(filename);
-
-    if (!file.open(QIODevice::ReadOnly)){
-        QMessageBox::warning(this,
-                             tr("File Not Loaded"),
-                             tr("For some reason the chosen file could not be loaded."),
-                             QMessageBox::Ok);
-        return;
-    }
 
-    QTextStream file_input_stream(&file);
-    QString dump, tmp;
-    QPixmap icon(16, 16);
-    int r, g, b;
-    int stream_value;
+    fileMessage = tr("Loading %1").arg(filename);
+    statusBar()->showMessage(fileMessage);
+    gameFile->load(filename, uM);
+}
 
-    switch (uM) {
 
-    // GAME OF LIFE
-    case 0:
-        file_input_stream >> stream_value;
-        ui->universeSizeControl->setValue(stream_value);
-
-        game->setUniverseSize(stream_value);
-        dump = "";
+void MainWindow::showFileProgress(int percent) {
+    statusBar()->showMessage(tr("%1: %2 %").arg(fileMessage).arg(percent));
+}
 
-        for (int k = 0; k != stream_value; k++) {
-            file_input_stream >> tmp;
-            dump.append(tmp + "\n");
-        }
-        game->reconstructGame(dump);
 
-        /* import the (rgb) cell color */
-        file_input_stream >> r >> g >> b;
-        currentColor = QColor(r, g, b);
-        game->setMasterColor(currentColor);
+void MainWindow::gameSaved(bool ok) {
+    statusBar()->showMessage(ok ? tr("Game saved.") : tr("Game not saved."), 5000);
+    if (!ok) {
+        QMessageBox::warning(this,
+                             tr("File Not Saved"),
+                             tr("For some reason the game could not be written to the chosen file: %1")
+                             .arg(gameFile->errorString()),
+                             QMessageBox::Ok);
+    }
+}
 
-        /* display specific color as icon on color buttons */
-        icon.fill(currentColor);
-        ui->colorSelectButton->setIcon(QIcon(icon));
 
-        /* import iteration interval */
-        file_input_stream >> r;
-        ui->intervalControl->setValue(r);
-        game->setInterval(r);
-        break;
+void MainWindow::gameLoaded(bool ok) {
+    /* swap the loaded game in; this runs between two generations, a running game is stopped first */
 
-    // SNAKE
-    case 1:
-        file_input_stream >> stream_value;
-        ui->universeSizeControl->setValue(stream_value);
-        game->setUniverseSize(stream_value);
+    GameFile::state state = gameFile->takeLoaded();
+    QString error = gameFile->errorString();
+    if (ok && state.mode != game->getUniverseMode()) {
+        // the mode was changed while the file was read
+        ok = false;
+        error = tr("The game mode has changed.");
+    }
+    statusBar()->showMessage(ok ? tr("Game loaded.") : tr("Game not loaded."), 5000);
+    if (!ok) {
+        QMessageBox::warning(this,
+                             tr("File Not Loaded"),
+                             tr("For some reason the chosen file could not be loaded: %1").arg(error),
+                             QMessageBox::Ok);
+        return;
+    }
 
-        file_input_stream >> r >> g >> b;
-        currentColor = QColor(r, g, b);
-        game->setMasterColor(currentColor);
-        icon.fill(currentColor);
-        ui->colorSelectButton->setIcon(QIcon(icon));
+    if (game->isRunning())
+        game->stopGame();
 
-        file_input_stream >> r;
-        ui->intervalControl->setValue(r);
-        game->setInterval(r);
+    ui->universeSizeControl->setValue(state.size);
+    game->setUniverseSize(state.size);
 
-        file_input_stream >> r >> g;
-        game->setDirectionSnake(r, g);
+    if (state.mode == 2) {
+        ui->cellModeControl->setCurrentIndex(state.cellMode);
+        ui->lifetimeControl->setValue(state.lifetime);
+        game->setLifetime(state.lifetime);
+    }
 
-        file_input_stream >> r;
-        game->setSnakeLength(r);
+    /* import the (rgb) cell color and display it as icon on the color button */
+    currentColor = QColor(state.red, state.green, state.blue);
+    game->setMasterColor(currentColor);
+    QPixmap icon(16, 16);
+    icon.fill(currentColor);
+    ui->colorSelectButton->setIcon(QIcon(icon));
 
-        file_input_stream >> r;
-        game->setSnakeAction(r);
+    /* import iteration interval */
+    ui->intervalControl->setValue(state.interval);
+    game->setInterval(state.interval);
 
-        file_input_stream >> r >> g;
-        game->setPositionSnakeHead(r, g);
+    game->setState(state);
+}
 
-        file_input_stream >> r >> g;
-        game->setPositionFood(r, g);
 
-        dump = "";
-        for (int k = 0; k != stream_value; k++) {
-            file_input_stream >> tmp;
-            dump.append(tmp + "\n");
-        }
-        //qDebug() << dump;
-        game->reconstructGame(dump);
-        break;
+void MainWindow::setTraceRecording(bool on) {
+    /* start a fresh timeline or stop recording */
 
-    // PREDATOR
-    case 2:
-        file_input_stream >> stream_value;
-        ui->universeSizeControl->setValue(stream_value);
-        game->setUniverseSize(stream_value);
-
-        file_input_stream >> r >> g >> b;
-        currentColor = QColor(r, g, b);
-        game->setMasterColor(currentColor);
-        icon.fill(currentColor);
-        ui->colorSelectButton->setIcon(QIcon(icon));
-
-        file_input_stream >> r;
-        ui->intervalControl->setValue(r);
-        game->setInterval(r);
-
-        file_input_stream >> r;
-        ui->cellModeControl->setCurrentIndex(r);
-
-        // reconstruct world
-        dump = "";
-        for (int k = 0; k != stream_value; k++) {
-            file_input_stream >> tmp;
-            dump.append(tmp + "\n");
-        }
-        game->reconstructGame(dump);
+    if (on) {
+        TraceRecorder::instance().clear();
+    }
+    TraceRecorder::instance().setEnabled(on);
+}
 
-        file_input_stream >> r;
-        ui->lifetimeControl->setValue(r);
-        game->setLifetime(r);
 
-        // reconstruct lifetime
-        dump = "";
-        for (int k = 0; k != stream_value; k++) {
-            file_input_stream >> tmp;
-            dump.append(tmp + "\n");
-        }
-        game->reconstructGame(dump, 'l');
+void MainWindow::saveTrace() {
+    /* write the recorded timeline as Chrome Trace Event JSON (Perfetto, about:tracing) */
 
-        break;
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save timeline"),
+                                                    QDir::homePath(), tr("Chrome Trace *.json Files (*.json)"));
+    if (filename.length() < 1)
+        return;
 
-    default:
-        break;
+    if (!TraceRecorder::instance().dump(filename)) {
+        QMessageBox::warning(this,
+                             tr("Timeline Not Saved"),
+                             tr("For some reason the timeline could not be written to the chosen file."),
+                             QMessageBox::Ok);
     }
-
 }
 
 
@@ -4,6 +4,8 @@
 #include <QMainWindow>
 #include <QColor>
 #include "gamewidget.h"
+#include "controlserver.h"
+#include "metricsexporter.h"
 
 namespace Ui {
 class MainWindow;
@@ -22,14 +24,24 @@ public slots:
     void selectRandomColor();
     void saveGame();
     void loadGame();
+    void showFileProgress(int percent);
+    void gameSaved(bool ok);
+    void gameLoaded(bool ok);
     void globalButtonControl(int uM);
     void enableControls(int uM, bool b);
     void disableControls(int uM, bool b);
+    void setTraceRecording(bool on);
+    void saveTrace();
+    void updateHistory(int position, int count);
 
 private:
     Ui::MainWindow *ui;
     QColor currentColor;
     GameWidget *game;
+    ControlServer *control;
+    MetricsExporter *metrics;
+    GameFile *gameFile;
+    QString fileMessage; // the running save or load, for the status bar
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,87 @@
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSaveFile>
+#include <QTimer>
+
+#include "metricsexporter.h"
+#include "localserver.h"
+#include "metricsregistry.h"
+
+
+MetricsExporter::MetricsExporter(QObject *parent) :
+    QObject(parent),
+    server(new QLocalServer(this)),
+    timer(new QTimer(this))
+{
+    connect(server, SIGNAL(newConnection()), this, SLOT(acceptClients()));
+    connect(timer, SIGNAL(timeout()), this, SLOT(dump()));
+}
+
+
+bool MetricsExporter::listen(const QString &name) {
+    return listenLocal(server, name);
+}
+
+
+QString MetricsExporter::errorString() const {
+    return server->errorString();
+}
+
+
+bool MetricsExporter::dumpTo(const QString &filename, int msec) {
+    this->filename = filename;
+    timer->start(msec);
+    return dump();
+}
+
+
+QByteArray MetricsExporter::scrape() {
+    emit scrapeRequested();
+    return MetricsRegistry::instance().scrape();
+}
+
+
+bool MetricsExporter::dump() {
+    /* replace the file with the current metrics */
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(scrape());
+    return file.commit();
+}
+
+
+void MetricsExporter::acceptClients() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+
+void MetricsExporter::readRequest() {
+    /* answer once the request is complete: the header of an HTTP GET or one line */
+
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket) return;
+
+    // the unread request stays in the socket until it is complete
+    QByteArray request = socket->peek(maxRequestBytes);
+    bool http = request.startsWith("GET ");
+    bool complete = http ? (request.contains("\r\n\r\n") || request.contains("\n\n")) : request.contains('\n');
+    if (!complete) {
+        if (request.size() >= maxRequestBytes) socket->abort();
+        return;
+    }
+
+    socket->disconnect(this);
+    socket->readAll();
+    QByteArray body = scrape();
+    if (http) {
+        socket->write("HTTP/1.0 200 OK\r\n"
+                      "Content-Type: text/plain; version=0.0.4\r\n"
+                      "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+    }
+    socket->write(body);
+    socket->disconnectFromServer();
+}
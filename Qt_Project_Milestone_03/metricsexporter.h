@@ -0,0 +1,58 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+
+class QLocalServer;
+class QTimer;
+
+class MetricsExporter : public QObject {
+    /* serves the MetricsRegistry in Prometheus text format
+     *
+     * On a local socket (Unix domain socket) every request gets the current metrics and
+     * the connection is closed: an HTTP GET, e.g. from
+     * `curl --unix-socket <name> http://localhost/metrics`, gets an HTTP/1.0 response, any
+     * other line just the text. Where nothing can reach the socket the metrics are written
+     * to a file every few seconds instead, replaced atomically so that a textfile collector
+     * never reads half a file.
+     *
+     * The window exports when the program is started with --metrics <name> or
+     * --metrics-file <path>.
+     */
+
+    Q_OBJECT
+
+public:
+    static const int maxRequestBytes = 8192;
+
+    explicit MetricsExporter(QObject *parent = 0);
+
+    // listen on the local socket name (see listenLocal)
+    bool listen(const QString &name);
+
+    QString errorString() const;
+
+    // write the metrics to filename now and then every msec
+    bool dumpTo(const QString &filename, int msec = 10000);
+
+    // the current metrics, after the gauges have been sampled
+    QByteArray scrape();
+
+signals:
+    // sample the gauges now (the scrape follows right after)
+    void scrapeRequested();
+
+private slots:
+    void acceptClients();
+    void readRequest();
+    bool dump();
+
+private:
+    QLocalServer *server;
+    QTimer *timer;
+    QString filename;
+};
+
+#endif // METRICSEXPORTER_H
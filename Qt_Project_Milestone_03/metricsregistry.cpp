@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstring>
+
+#include "metricsregistry.h"
+
+
+const double MetricsRegistry::bounds[MetricsRegistry::boundCount] = {
+    0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+    0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+
+static quint64 doubleBits(double v) {
+    quint64 bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+
+static double bitsDouble(quint64 bits) {
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+
+static QByteArray number(double v) {
+    return QByteArray::number(v, 'g', 15);
+}
+
+
+MetricsRegistry &MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+
+MetricsRegistry::MetricsRegistry() :
+    metricCount(0),
+    slotCount(0)
+{
+}
+
+
+MetricsRegistry::shardOwner::~shardOwner() {
+    /* the thread ends: keep its counts and hand its shard to the next thread */
+
+    if (!s) return;
+    MetricsRegistry &r = MetricsRegistry::instance();
+    std::lock_guard<std::mutex> guard(r.registry);
+    r.idleShards.push_back(s);
+}
+
+
+MetricsRegistry::shard *MetricsRegistry::localShard() {
+    /* shard of the calling thread, taken from the pool or created on first use */
+
+    thread_local shardOwner owner = {0};
+    if (!owner.s) {
+        std::lock_guard<std::mutex> guard(registry);
+        if (!idleShards.empty()) {
+            owner.s = idleShards.back();
+            idleShards.pop_back();
+        } else {
+            owner.s = new shard;
+            for (int i = 0; i < maxSlots; i++) {
+                owner.s->slots[i].store(0, std::memory_order_relaxed);
+            }
+            shards.push_back(owner.s);
+        }
+    }
+    return owner.s;
+}
+
+
+int MetricsRegistry::add(const char *name, const char *help, const char *labels, Kind kind, int slots) {
+    std::lock_guard<std::mutex> guard(registry);
+    for (int i = 0; i < metricCount; i++) {
+        if (metrics[i]->kind == kind && metrics[i]->name == name && metrics[i]->labels == labels)
+            return i;
+    }
+    if (metricCount == maxMetrics || slotCount + slots > maxSlots) return -1;
+
+    metric *m = new metric;
+    m->name = name;
+    m->help = help;
+    m->labels = labels;
+    m->kind = kind;
+    m->slot = slotCount;
+    m->value.store(doubleBits(0.0), std::memory_order_relaxed);
+    slotCount += slots;
+    metrics[metricCount] = m;
+    return metricCount++;
+}
+
+
+int MetricsRegistry::counter(const char *name, const char *help, const char *labels) {
+    return add(name, help, labels, Counter, 1);
+}
+
+
+int MetricsRegistry::gauge(const char *name, const char *help, const char *labels) {
+    return add(name, help, labels, Gauge, 0);
+}
+
+
+int MetricsRegistry::histogram(const char *name, const char *help, const char *labels) {
+    // a count per bucket and +Inf, then the sum of the observed values
+    return add(name, help, labels, Histogram, boundCount + 2);
+}
+
+
+void MetricsRegistry::add(int id, quint64 n) {
+    if (id < 0) return;
+    bump(localShard()->slots[metrics[id]->slot], n);
+}
+
+
+void MetricsRegistry::set(int id, double value) {
+    if (id < 0) return;
+    metrics[id]->value.store(doubleBits(value), std::memory_order_relaxed);
+}
+
+
+void MetricsRegistry::observe(int id, double seconds) {
+    if (id < 0) return;
+    std::atomic<quint64> *slots = localShard()->slots + metrics[id]->slot;
+    int bucket = int(std::lower_bound(bounds, bounds + boundCount, seconds) - bounds);
+    bump(slots[bucket], 1);
+
+    std::atomic<quint64> &sum = slots[boundCount + 1];
+    sum.store(doubleBits(bitsDouble(sum.load(std::memory_order_relaxed)) + seconds), std::memory_order_relaxed);
+}
+
+
+quint64 MetricsRegistry::sum(int slot) const {
+    quint64 total = 0;
+    for (shard *s : shards) {
+        total += s->slots[slot].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+
+QByteArray MetricsRegistry::scrape() const {
+    /* one HELP and TYPE line per name, then the samples of all its label sets */
+
+    static const char *kindNames[] = {"counter", "gauge", "histogram"};
+
+    std::lock_guard<std::mutex> guard(registry);
+    QByteArray out;
+    std::vector<bool> written(metricCount, false);
+    for (int i = 0; i < metricCount; i++) {
+        if (written[i]) continue;
+        const metric *first = metrics[i];
+        out += "# HELP " + first->name + " " + first->help + "\n";
+        out += "# TYPE " + first->name + " " + kindNames[first->kind] + "\n";
+
+        for (int j = i; j < metricCount; j++) {
+            const metric *m = metrics[j];
+            if (written[j] || m->name != first->name) continue;
+            written[j] = true;
+
+            QByteArray labels = m->labels.isEmpty() ? QByteArray() : "{" + m->labels + "}";
+            switch (m->kind) {
+            case Counter:
+                out += m->name + labels + " " + QByteArray::number(sum(m->slot)) + "\n";
+                break;
+            case Gauge:
+                out += m->name + labels + " " + number(bitsDouble(m->value.load(std::memory_order_relaxed))) + "\n";
+                break;
+            case Histogram: {
+                QByteArray prefix = m->labels.isEmpty() ? QByteArray("{") : "{" + m->labels + ",";
+                quint64 count = 0;
+                for (int b = 0; b <= boundCount; b++) {
+                    count += sum(m->slot + b);
+                    QByteArray le = (b < boundCount) ? number(bounds[b]) : QByteArray("+Inf");
+                    out += m->name + "_bucket" + prefix + "le=\"" + le + "\"} " + QByteArray::number(count) + "\n";
+                }
+                double total = 0.0;
+                for (shard *s : shards) {
+                    total += bitsDouble(s->slots[m->slot + boundCount + 1].load(std::memory_order_relaxed));
+                }
+                out += m->name + "_sum" + labels + " " + number(total) + "\n";
+                out += m->name + "_count" + labels + " " + QByteArray::number(count) + "\n";
+                break;
+            }
+            }
+        }
+    }
+    return out;
+}
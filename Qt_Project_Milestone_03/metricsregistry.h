@@ -0,0 +1,113 @@
+#ifndef METRICSREGISTRY_H
+#define METRICSREGISTRY_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+#include <QElapsedTimer>
+
+class MetricsRegistry {
+    /* counters, gauges and latency histograms of a running instance, in Prometheus text format
+     *
+     * Counters and histograms live in per-thread shards: an update is a relaxed load and
+     * store to a slot that only the calling thread writes, so the hot path takes no lock
+     * and shares no cache line. A scrape sums the shards of all threads. The shard of a
+     * thread that ends goes back to a pool and is taken over, counts included, by the next
+     * new thread, so short-lived pool threads neither lose counts nor grow the registry.
+     * Gauges hold one value that the last writer sets.
+     */
+
+public:
+    static MetricsRegistry &instance();
+
+    // register a metric or look up the one of the same name and labels; the id is the
+    // handle for updates, -1 once the registry is full. labels: `state="prey"` or ""
+    int counter(const char *name, const char *help, const char *labels = "");
+
+    int gauge(const char *name, const char *help, const char *labels = "");
+
+    // latency in seconds, buckets from 10 us to 10 s
+    int histogram(const char *name, const char *help, const char *labels = "");
+
+    void add(int id, quint64 n = 1);
+
+    void set(int id, double value);
+
+    void observe(int id, double seconds);
+
+    // the text exposition of all metrics
+    QByteArray scrape() const;
+
+    static const int maxMetrics = 256;
+    static const int maxSlots = 2048;
+    static const int boundCount = 19;
+    static const double bounds[boundCount];
+
+private:
+    MetricsRegistry();
+
+    enum Kind {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    struct metric {
+        QByteArray name;
+        QByteArray help;
+        QByteArray labels;
+        Kind kind;
+        int slot;                 // first shard slot of a counter or histogram
+        std::atomic<quint64> value; // bits of the double of a gauge
+    };
+
+    struct shard {
+        std::atomic<quint64> slots[maxSlots];
+    };
+
+    struct shardOwner {
+        shard *s;
+        ~shardOwner();
+    };
+
+    int add(const char *name, const char *help, const char *labels, Kind kind, int slots);
+
+    shard *localShard();
+
+    static void bump(std::atomic<quint64> &slot, quint64 n) {
+        // only the owning thread writes the slot, a plain add without a locked instruction
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    quint64 sum(int slot) const;
+
+    mutable std::mutex registry; // guards registration and the shard lists, taken once per thread and on scrape
+    metric *metrics[maxMetrics]; // written before the id is handed out, never moved
+    int metricCount;
+    int slotCount;
+    std::vector<shard*> shards;
+    std::vector<shard*> idleShards;
+};
+
+
+class MetricsScope {
+    /* observes the lifetime of the scope in a latency histogram */
+
+public:
+    explicit MetricsScope(int id) :
+        id(id)
+        { timer.start(); }
+
+    ~MetricsScope() {
+        MetricsRegistry::instance().observe(id, timer.nsecsElapsed() * 1e-9);
+    }
+
+private:
+    int id;
+    QElapsedTimer timer;
+};
+
+#endif // METRICSREGISTRY_H
@@ -0,0 +1,92 @@
+#include <QtAlgorithms>
+#include <qmath.h>
+
+#include "perfstats.h"
+
+
+void PerfHistogram::reset() {
+    for (int i = 0; i < bucketCount; i++) {
+        buckets[i] = 0;
+    }
+    count = 0;
+    sum = 0;
+}
+
+
+void PerfHistogram::add(qint64 ns) {
+    /* bucket = 4 * octave + the two bits below the leading one */
+
+    quint64 v = (ns > 0) ? quint64(ns) : 1;
+    int octave = 63 - qCountLeadingZeroBits(v);
+    int sub = (octave >= 2) ? int((v >> (octave - 2)) & 3) : int((v << (2 - octave)) & 3);
+    int i = 4 * octave + sub;
+    if (i >= bucketCount) i = bucketCount - 1;
+
+    buckets[i]++;
+    count++;
+    sum += v;
+}
+
+
+double PerfHistogram::percentile(double q) const {
+    /* walk the buckets and report the middle of the one holding the q-th sample */
+
+    if (count == 0) return 0.0;
+    quint64 rank = quint64(q * (count - 1)) + 1;
+    quint64 seen = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            int octave = i / 4;
+            double low = qPow(2.0, octave) * (1.0 + (i % 4) / 4.0);
+            double high = qPow(2.0, octave) * (1.0 + (i % 4 + 1) / 4.0);
+            return (low + high) / 2;
+        }
+    }
+    return 0.0;
+}
+
+
+PerfStats::PerfStats() :
+    windowGenerations(0),
+    windowCells(0),
+    generationRate(0.0),
+    cellRate(0.0)
+{
+    window.start();
+}
+
+
+void PerfStats::countGeneration(qint64 cells) {
+    /* generations/s and cells/s, refreshed about once a second */
+
+    windowGenerations++;
+    windowCells += cells;
+
+    qint64 ns = window.nsecsElapsed();
+    if (ns >= 1000000000) {
+        generationRate = windowGenerations * 1e9 / ns;
+        cellRate = windowCells * 1e9 / ns;
+        windowGenerations = 0;
+        windowCells = 0;
+        window.restart();
+    }
+}
+
+
+void PerfStats::reset() {
+    for (int i = 0; i < StageCount; i++) {
+        stages[i].reset();
+    }
+    windowGenerations = 0;
+    windowCells = 0;
+    generationRate = 0.0;
+    cellRate = 0.0;
+    window.restart();
+}
+
+
+const char *PerfStats::stageName(Stage stage) {
+    const char *names[StageCount] = {"step", "end check", "update", "paint", "paint grid", "paint universe"};
+    return names[stage];
+}
@@ -0,0 +1,116 @@
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+
+class PerfHistogram {
+    /* fixed-size latency histogram: four buckets per power of two nanoseconds */
+
+public:
+    static const int bucketCount = 4 * 40; // up to about 18 minutes
+
+    PerfHistogram() {
+        reset();
+    }
+
+    void reset();
+
+    void add(qint64 ns);
+
+    quint64 getCount() const {
+        return count;
+    }
+
+    double mean() const {
+        return count ? double(sum) / count : 0.0;
+    }
+
+    // latency in ns below which the fraction q of all samples lies
+    double percentile(double q) const;
+
+private:
+    quint64 buckets[bucketCount];
+    quint64 count;
+    quint64 sum;
+};
+
+
+class PerfStats {
+    /* per-stage timing of the game loop and the renderer */
+
+public:
+    enum Stage {
+        Step,
+        EndCheck,
+        Update,
+        Paint,
+        PaintGrid,
+        PaintUniverse,
+        StageCount
+    };
+
+    PerfStats();
+
+    void add(Stage stage, qint64 ns) {
+        stages[stage].add(ns);
+    }
+
+    const PerfHistogram &histogram(Stage stage) const {
+        return stages[stage];
+    }
+
+    void countGeneration(qint64 cells);
+
+    double generationsPerSecond() const {
+        return generationRate;
+    }
+
+    double cellsPerSecond() const {
+        return cellRate;
+    }
+
+    void reset();
+
+    static const char *stageName(Stage stage);
+
+private:
+    PerfHistogram stages[StageCount];
+    QElapsedTimer window;
+    qint64 windowGenerations;
+    qint64 windowCells;
+    double generationRate;
+    double cellRate;
+};
+
+
+class PerfScope {
+    /* adds the lifetime of the scope to one stage */
+
+public:
+    PerfScope(PerfStats &stats, PerfStats::Stage stage) :
+        stats(stats),
+        stage(stage)
+        { timer.start(); }
+
+    ~PerfScope() {
+        stats.add(stage, timer.nsecsElapsed());
+    }
+
+private:
+    PerfStats &stats;
+    PerfStats::Stage stage;
+    QElapsedTimer timer;
+};
+
+
+// time the rest of the enclosing block; compiles to nothing unless CA_PERF is defined
+#ifdef CA_PERF
+#define CA_PERF_CONCAT2(a, b) a##b
+#define CA_PERF_CONCAT(a, b) CA_PERF_CONCAT2(a, b)
+#define CA_PERF_SCOPE(stats, stage) PerfScope CA_PERF_CONCAT(perfScope, __LINE__)(stats, stage)
+#else
+#define CA_PERF_SCOPE(stats, stage)
+#endif
+
+#endif // PERFSTATS_H
@@ -0,0 +1,173 @@
+#include <stdlib.h>
+
+#include "snakeautopilot.h"
+
+
+static const int directions[4] = {8, 2, 4, 6}; // up, down, left, right
+
+
+static int stepX(int d) {
+    return (d == 4) ? -1 : ((d == 6) ? 1 : 0);
+}
+
+
+static int stepY(int d) {
+    return (d == 8) ? -1 : ((d == 2) ? 1 : 0);
+}
+
+
+SnakeView SnakeView::of(const CAbase &ca) {
+    CAview state = ca.view();
+    SnakeView view;
+    view.cells = state.world;
+    view.nx = state.nx;
+    view.ny = state.ny;
+    view.headX = state.headX;
+    view.headY = state.headY;
+    view.foodX = state.foodX;
+    view.foodY = state.foodY;
+    view.direction = state.directionPast;
+    view.length = state.snakeLength;
+    return view;
+}
+
+
+SnakeAutopilot *SnakeAutopilot::create(int kind) {
+    switch (kind) {
+    case Greedy:
+        return new GreedyAutopilot;
+    case ShortestPath:
+        return new ShortestPathAutopilot;
+    case HamiltonianCycle:
+        return new HamiltonianAutopilot;
+    default:
+        return 0;
+    }
+}
+
+
+int GreedyAutopilot::nextDirection(const SnakeView &view) {
+    /* among the safe directions take the one closest to the food */
+
+    int best = view.direction;
+    int bestDistance = -1;
+
+    for (int d : directions) {
+        if (d + view.direction == 10) continue; // no reversing
+        int x = view.headX + stepX(d);
+        int y = view.headY + stepY(d);
+        if (!view.isFree(x, y)) continue;
+
+        int distance = abs(view.foodX - x) + abs(view.foodY - y);
+        if (bestDistance < 0 || distance < bestDistance) {
+            best = d;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+
+int ShortestPathAutopilot::nextDirection(const SnakeView &view) {
+    /* breadth first search from the head, remember for every cell the first step taken */
+
+    const int stride = view.nx + 2;
+    const size_t cellCount = size_t(stride) * (view.ny + 2);
+    if (visited.size() < cellCount) {
+        queue.resize(cellCount);
+        visited.assign(cellCount, 0);
+        firstStep.resize(cellCount);
+        stamp = 0;
+    }
+    if (++stamp == 0) { // stamp wrapped around, really clear once
+        visited.assign(visited.size(), 0);
+        stamp = 1;
+    }
+
+    const int food = view.foodY * stride + view.foodX;
+    int head = 0;
+    int tail = 0;
+
+    for (int d : directions) {
+        if (d + view.direction == 10) continue;
+        int x = view.headX + stepX(d);
+        int y = view.headY + stepY(d);
+        if (!view.isFree(x, y)) continue;
+
+        int i = y * stride + x;
+        if (i == food) return d;
+        visited[i] = stamp;
+        firstStep[i] = d;
+        queue[tail++] = i;
+    }
+
+    const int offsets[4] = {-stride, stride, -1, 1};
+    while (head < tail) {
+        int i = queue[head++];
+        for (int k = 0; k < 4; k++) {
+            int j = i + offsets[k];
+            if (visited[j] == stamp) continue;
+            int v = view.cells[j];
+            if (v != 0 && v != 5) continue;
+            if (j == food) return firstStep[i];
+            visited[j] = stamp;
+            firstStep[j] = firstStep[i];
+            queue[tail++] = j;
+        }
+    }
+
+    // food is out of reach, at least stay alive
+    return fallback.nextDirection(view);
+}
+
+
+void HamiltonianAutopilot::buildCycle(int w, int h) {
+    /* boustrophedon through columns 2..w (rows when w is the odd side) with column 1 as way back */
+
+    nx = w;
+    ny = h;
+    cycleDirection.assign(size_t(w + 2) * (h + 2), 0);
+
+    // lay the cycle out along rows if the number of rows is even, otherwise along columns
+    bool transpose = (h % 2 != 0);
+    if (transpose && w % 2 != 0) return; // both sides odd: there is no Hamiltonian cycle
+    int a = transpose ? h : w; // cells per lane
+    int b = transpose ? w : h; // number of lanes (even)
+    if (a < 2) return;
+
+    auto set = [this, transpose](int i, int j, int d) {
+        // i along the lane, j across; swap axes and directions when transposed
+        if (transpose) {
+            const int swapped[9] = {0, 0, 6, 0, 8, 0, 2, 0, 4};
+            cycleDirection[i * (nx + 2) + j] = swapped[d];
+        } else {
+            cycleDirection[j * (nx + 2) + i] = d;
+        }
+    };
+
+    for (int j = 1; j <= b; j++) {
+        if (j % 2 == 1) {
+            for (int i = 2; i < a; i++) set(i, j, 6);
+            set(a, j, 2);
+        } else {
+            for (int i = a; i > 2; i--) set(i, j, 4);
+            set(2, j, (j == b) ? 4 : 2);
+        }
+    }
+    for (int j = 2; j <= b; j++) set(1, j, 8);
+    set(1, 1, 6);
+}
+
+
+int HamiltonianAutopilot::nextDirection(const SnakeView &view) {
+    if (view.nx != nx || view.ny != ny) {
+        buildCycle(view.nx, view.ny);
+    }
+
+    int d = cycleDirection[view.headY * (nx + 2) + view.headX];
+    if (d == 0 || d + view.direction == 10 ||
+            !view.isFree(view.headX + stepX(d), view.headY + stepY(d))) {
+        return fallback.nextDirection(view);
+    }
+    return d;
+}
@@ -0,0 +1,104 @@
+#ifndef SNAKEAUTOPILOT_H
+#define SNAKEAUTOPILOT_H
+
+#include <vector>
+#include "CAbase.h"
+
+struct SnakeView {
+    /* read-only view of a snake board, valid until the board is stepped or resized */
+
+    const int *cells; // stride nx + 2, see CAbase::getValue
+    int nx;
+    int ny;
+    int headX;
+    int headY;
+    int foodX;
+    int foodY;
+    int direction; // direction of the last move (2 down, 4 left, 6 right, 8 up)
+    int length;
+
+    int value(int x, int y) const {
+        return cells[y * (nx + 2) + x];
+    }
+
+    bool isFree(int x, int y) const {
+        // empty or food, the halo is -1
+        int v = value(x, y);
+        return v == 0 || v == 5;
+    }
+
+    static SnakeView of(const CAbase &ca);
+};
+
+
+class SnakeAutopilot {
+    /* steers the snake: called once per tick, returns the next direction (2, 4, 6 or 8) */
+
+public:
+    enum Kind {
+        Off,
+        Greedy,
+        ShortestPath,
+        HamiltonianCycle
+    };
+
+    virtual ~SnakeAutopilot() {}
+
+    virtual int nextDirection(const SnakeView &view) = 0;
+
+    // new autopilot of the given kind, 0 for Off
+    static SnakeAutopilot *create(int kind);
+};
+
+
+class GreedyAutopilot : public SnakeAutopilot {
+    /* safe neighbor closest to the food (Manhattan distance) */
+
+public:
+    int nextDirection(const SnakeView &view);
+};
+
+
+class ShortestPathAutopilot : public SnakeAutopilot {
+    /* first step of a shortest path (BFS) to the food, greedy when the food is unreachable
+     *
+     * The BFS buffers only grow with the board; cells are marked with a per-search stamp
+     * instead of clearing, so a tick allocates nothing.
+     */
+
+public:
+    ShortestPathAutopilot() : stamp(0) {}
+
+    int nextDirection(const SnakeView &view);
+
+private:
+    std::vector<int> queue;
+    std::vector<unsigned int> visited;
+    std::vector<int> firstStep;
+    unsigned int stamp;
+    GreedyAutopilot fallback;
+};
+
+
+class HamiltonianAutopilot : public SnakeAutopilot {
+    /* follows a fixed cycle through every cell, so the snake never dies
+     *
+     * The cycle exists when one side of the board is even; otherwise, or when the cycle
+     * would reverse the snake, the shortest path autopilot decides.
+     */
+
+public:
+    HamiltonianAutopilot() : nx(0), ny(0) {}
+
+    int nextDirection(const SnakeView &view);
+
+private:
+    void buildCycle(int w, int h);
+
+    int nx;
+    int ny;
+    std::vector<int> cycleDirection; // direction to the successor of every cell
+    ShortestPathAutopilot fallback;
+};
+
+#endif // SNAKEAUTOPILOT_H
@@ -0,0 +1,77 @@
+#ifndef SNAKEINPUT_H
+#define SNAKEINPUT_H
+
+#include <QtGlobal>
+
+class SnakeInputQueue {
+    /* arrow keys typed between two snake moves, oldest first
+     *
+     * Every move takes one direction from the queue, so two quick presses (up, then left
+     * around a corner) become two moves instead of the second overwriting the first. A
+     * direction is checked against the one it follows (the last queued one, or the
+     * current one for an empty queue): turning back onto the snake and repeating the
+     * same direction are dropped, as is anything typed while the queue is full. Each
+     * entry keeps the time of its key press for measuring the input latency.
+     */
+
+public:
+    static const int capacity = 4;
+
+    struct input {
+        int direction; // 2 down, 4 left, 6 right, 8 up
+        qint64 time;   // ns of the key press, on the clock of the caller
+    };
+
+    SnakeInputQueue() :
+        first(0),
+        count(0)
+        {}
+
+    bool isEmpty() const {
+        return count == 0;
+    }
+
+    int size() const {
+        return count;
+    }
+
+    void clear() {
+        first = 0;
+        count = 0;
+    }
+
+    // queue direction pressed at time, the snake currently heads in direction current
+    bool push(int direction, qint64 time, int current);
+
+    // the oldest queued direction, the queue must not be empty
+    input pop();
+
+private:
+    input entries[capacity];
+    int first;
+    int count;
+};
+
+
+inline bool SnakeInputQueue::push(int direction, qint64 time, int current) {
+    int previous = (count > 0) ? entries[(first + count - 1) % capacity].direction : current;
+    // opposing directions add up to 10 (see CAbase::turnSnake)
+    if (count == capacity || direction == previous || direction + previous == 10) {
+        return false;
+    }
+    input &in = entries[(first + count) % capacity];
+    in.direction = direction;
+    in.time = time;
+    count++;
+    return true;
+}
+
+
+inline SnakeInputQueue::input SnakeInputQueue::pop() {
+    input in = entries[first];
+    first = (first + 1) % capacity;
+    count--;
+    return in;
+}
+
+#endif // SNAKEINPUT_H
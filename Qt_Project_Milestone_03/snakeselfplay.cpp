@@ -0,0 +1,84 @@
+#include <memory>
+#include <vector>
+#include <QElapsedTimer>
+
+#include "CAbase.h"
+#include "snakeautopilot.h"
+#include "snakeselfplay.h"
+#include "workstealingpool.h"
+
+
+SnakeSelfPlay::SnakeSelfPlay(int universeSize, int autopilot) :
+    universeSize(universeSize),
+    autopilot(autopilot),
+    threads(0),
+    baseSeed(1)
+{
+    total = results {0, 0, 0, 0, 0, 0.0};
+}
+
+
+void SnakeSelfPlay::run(int games) {
+    /* play the games and sum up the per-worker results */
+
+    WorkStealingPool pool(threads);
+    int workers = pool.getThreadCount();
+    const results zero = {0, 0, 0, 0, 0, 0.0};
+    const int cells = universeSize * universeSize;
+
+    std::vector<CAbase> boards;
+    boards.reserve(workers);
+    std::vector<std::unique_ptr<SnakeAutopilot> > pilots;
+    std::vector<results> partial(workers, zero);
+    for (int w = 0; w < workers; w++) {
+        boards.emplace_back(universeSize, universeSize);
+        pilots.push_back(std::unique_ptr<SnakeAutopilot>(SnakeAutopilot::create(autopilot)));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    pool.run(games, [&](int game, int worker) {
+        CAbase &ca = boards[worker];
+        SnakeAutopilot *pilot = pilots[worker].get();
+        results &r = partial[worker];
+
+        ca.resetWorldSize(universeSize, universeSize);
+        ca.setSeed(baseSeed + unsigned(game));
+        ca.putInitSnake();
+        ca.putNewFood();
+
+        int stepsSinceFood = 0;
+        while (stepsSinceFood < 4 * cells) {
+            if (pilot) {
+                ca.turnSnake(pilot->nextDirection(SnakeView::of(ca)));
+            }
+            int length = ca.getSnakeLength();
+            ca.worldEvolutionSnake();
+            if (ca.isNotChanged()) break; // hit an obstacle
+
+            r.steps++;
+            stepsSinceFood++;
+            if (ca.getSnakeLength() > length) {
+                r.food++;
+                stepsSinceFood = 0;
+            }
+            if (ca.getSnakeLength() >= cells) { // board filled
+                r.wins++;
+                break;
+            }
+        }
+        r.games++;
+        r.lengthSum += ca.getSnakeLength();
+    });
+
+    total = zero;
+    for (int w = 0; w < workers; w++) {
+        total.games += partial[w].games;
+        total.steps += partial[w].steps;
+        total.food += partial[w].food;
+        total.lengthSum += partial[w].lengthSum;
+        total.wins += partial[w].wins;
+    }
+    total.seconds = timer.nsecsElapsed() / 1e9;
+}
@@ -0,0 +1,46 @@
+#ifndef SNAKESELFPLAY_H
+#define SNAKESELFPLAY_H
+
+class SnakeSelfPlay {
+    /* play many snake games with an autopilot on all cores
+     *
+     * Every worker owns one board and one autopilot for all of its games, so apart from
+     * starting a game nothing is allocated. A game ends when the snake dies, fills the
+     * board or goes too long without eating.
+     */
+
+public:
+    SnakeSelfPlay(int universeSize, int autopilot);
+
+    void setThreads(int n) {
+        threads = n;
+    }
+
+    void setBaseSeed(unsigned int s) {
+        baseSeed = s;
+    }
+
+    void run(int games);
+
+    struct results {
+        long long games;
+        long long steps;
+        long long food;
+        long long lengthSum;
+        long long wins;
+        double seconds;
+    };
+
+    const results &getResults() const {
+        return total;
+    }
+
+private:
+    int universeSize;
+    int autopilot;
+    int threads;
+    unsigned int baseSeed;
+    results total;
+};
+
+#endif // SNAKESELFPLAY_H
@@ -0,0 +1,390 @@
+#include <memory>
+#include <algorithm>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+
+#include "CAbase.h"
+#include "CAsparse.h"
+#include "soupcensus.h"
+#include "workstealingpool.h"
+
+
+static const int checkInterval = 8; // generations between two settle checks
+static const int edgeBand = 8;      // spaceships this close to the edge are taken off the board
+static const int edgePeriod = 4;    // period of the spaceships looked for at the edge (gliders, *WSS)
+
+
+struct SoupCensus::workerState {
+    CAbase board;
+    CAsparse plane;             // isolated objects
+    std::vector<int> visited;   // stamp of the last pass that reached a board cell
+    int stamp;
+    std::vector<int> queue;
+    std::vector<int> populations;
+    std::vector<cell> cells;
+    std::vector<std::vector<cell> > phases;
+    std::map<std::string, object> census;
+    long long soups;
+    long long settled;
+    long long generations;
+
+    explicit workerState(int n) :
+        board(n, n),
+        visited(size_t(n + 2) * (n + 2), 0),
+        stamp(0),
+        soups(0),
+        settled(0),
+        generations(0)
+        {}
+};
+
+
+static bool isPeriodic(const std::vector<int> &populations, int maxPeriod) {
+    /* population of the last 2 * maxPeriod generations repeats with some period up to maxPeriod */
+
+    const int window = 2 * maxPeriod;
+    const int n = int(populations.size());
+    if (n < window + maxPeriod) return false;
+
+    for (int p = 1; p <= maxPeriod; p++) {
+        bool same = true;
+        for (int i = n - window; i < n && same; i++) {
+            same = populations[i] == populations[i - p];
+        }
+        if (same) return true;
+    }
+    return false;
+}
+
+
+static void normalize(std::vector<SoupCensus::cell> &cells, int &minX, int &minY) {
+    /* move the cells to a bounding box starting at 0, 0 and sort them row by row */
+
+    minX = minY = 0;
+    if (cells.empty()) return;
+    minX = cells[0].x;
+    minY = cells[0].y;
+    for (const SoupCensus::cell &c : cells) {
+        minX = std::min(minX, c.x);
+        minY = std::min(minY, c.y);
+    }
+    for (SoupCensus::cell &c : cells) {
+        c.x -= minX;
+        c.y -= minY;
+    }
+    std::sort(cells.begin(), cells.end(), [](const SoupCensus::cell &a, const SoupCensus::cell &b) {
+        return (a.y != b.y) ? a.y < b.y : a.x < b.x;
+    });
+}
+
+
+static bool sameShape(const std::vector<SoupCensus::cell> &a, const std::vector<SoupCensus::cell> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+    }
+    return true;
+}
+
+
+static bool codeLess(const std::string &a, const std::string &b) {
+    return (a.size() != b.size()) ? a.size() < b.size() : a < b;
+}
+
+
+SoupCensus::SoupCensus(int universeSize, int soupSize, double density) :
+    universeSize(universeSize),
+    soupSize(std::min(soupSize, universeSize)),
+    density(density),
+    threads(0),
+    baseSeed(1),
+    maxGenerations(10000)
+{
+    total.soups = total.settled = total.generations = 0;
+    total.seconds = 0.0;
+    total.threads = 0;
+}
+
+
+std::string SoupCensus::canonicalCode(const std::vector<cell> &cells) {
+    /* smallest encoding of the cells over the eight symmetries
+     *
+     * A row is written as hex digits of four columns each (leftmost column in the lowest
+     * bit, trailing zero digits dropped), rows are separated by 'z'.
+     */
+
+    std::string best;
+    std::vector<cell> t(cells.size());
+
+    for (int symmetry = 0; symmetry < 8; symmetry++) {
+        for (size_t i = 0; i < cells.size(); i++) {
+            int x = cells[i].x;
+            int y = cells[i].y;
+            if (symmetry & 4) std::swap(x, y);
+            if (symmetry & 1) x = -x;
+            if (symmetry & 2) y = -y;
+            t[i].x = x;
+            t[i].y = y;
+        }
+        int minX, minY;
+        normalize(t, minX, minY);
+
+        std::string code;
+        int width = 0;
+        int height = t.empty() ? 0 : t.back().y + 1;
+        for (const cell &c : t) width = std::max(width, c.x + 1);
+
+        std::vector<int> digits((width + 3) / 4);
+        size_t next = 0;
+        for (int y = 0; y < height; y++) {
+            std::fill(digits.begin(), digits.end(), 0);
+            for (; next < t.size() && t[next].y == y; next++) {
+                digits[t[next].x / 4] |= 1 << (t[next].x % 4);
+            }
+            int used = int(digits.size());
+            while (used > 0 && digits[used - 1] == 0) used--;
+
+            if (y > 0) code += 'z';
+            for (int d = 0; d < used; d++) {
+                code += "0123456789abcdef"[digits[d]];
+            }
+        }
+
+        if (symmetry == 0 || codeLess(code, best)) best = code;
+    }
+    return best;
+}
+
+
+void SoupCensus::classify(workerState &w, const std::vector<cell> &cells, int periodLimit,
+                          std::string &code, object &info) {
+    /* run the object alone until it repeats itself, possibly moved, within periodLimit generations */
+
+    info.kind = Unidentified;
+    info.period = 0;
+    info.population = int(cells.size());
+    info.count = 0;
+    code = "unidentified";
+
+    std::vector<cell> start(cells);
+    int minX, minY;
+    normalize(start, minX, minY);
+    for (const cell &c : start) {
+        if (c.x >= maxObjectSize || c.y >= maxObjectSize) return;
+    }
+
+    CAsparse &plane = w.plane;
+    plane.clear();
+    for (const cell &c : start) {
+        plane.setValue(c.x, c.y, 1);
+    }
+
+    w.phases.clear();
+    w.phases.push_back(start);
+
+    for (int t = 1; t <= periodLimit; t++) {
+        plane.worldEvolutionLife();
+        if (plane.getPopulation() == 0) return;
+
+        w.cells.clear();
+        plane.forEachCell([&w](int x, int y) {
+            cell c = {x, y};
+            w.cells.push_back(c);
+        });
+        int dx, dy;
+        normalize(w.cells, dx, dy);
+
+        if (sameShape(w.cells, start)) {
+            info.period = t;
+            info.kind = (dx != 0 || dy != 0) ? Spaceship : ((t == 1) ? StillLife : Oscillator);
+
+            std::string body;
+            for (const std::vector<cell> &phase : w.phases) {
+                std::string c = canonicalCode(phase);
+                if (body.empty() || codeLess(c, body)) body = c;
+                info.population = std::min(info.population, int(phase.size()));
+            }
+
+            switch (info.kind) {
+            case StillLife:
+                code = "xs" + std::to_string(info.population);
+                break;
+            case Oscillator:
+                code = "xp" + std::to_string(t);
+                break;
+            default:
+                code = "xq" + std::to_string(t);
+                break;
+            }
+            code += "_" + body;
+            return;
+        }
+        w.phases.push_back(w.cells);
+    }
+}
+
+
+void SoupCensus::collectObjects(workerState &w, bool edgeOnly) {
+    /* split the living cells into objects and count them
+     *
+     * With edgeOnly only objects reaching into the edge band are looked at, and of those
+     * only spaceships are counted and taken off the board.
+     */
+
+    CAbase &ca = w.board;
+    const int n = universeSize;
+    const int stride = n + 2;
+    const int *world = ca.getWorld();
+
+    if (++w.stamp == 0) {
+        std::fill(w.visited.begin(), w.visited.end(), 0);
+        w.stamp = 1;
+    }
+    if (w.queue.size() < w.visited.size()) w.queue.resize(w.visited.size());
+
+    std::vector<cell> cells;
+    std::string code;
+    object info;
+
+    for (int y = 1; y <= n; y++) {
+        bool edgeRow = (y <= edgeBand || y > n - edgeBand);
+        for (int x = 1; x <= n; x++) {
+            // in the middle rows of the board only the left and right edge bands are seeds
+            if (edgeOnly && !edgeRow && x == edgeBand + 1) x = n - edgeBand + 1;
+
+            int i = y * stride + x;
+            if (world[i] != 1 || w.visited[i] == w.stamp) continue;
+
+            // breadth first over all cells at most two apart
+            cells.clear();
+            int head = 0;
+            int tail = 0;
+            w.queue[tail++] = i;
+            w.visited[i] = w.stamp;
+            while (head < tail) {
+                int j = w.queue[head++];
+                int cx = j % stride;
+                int cy = j / stride;
+                cell c = {cx, cy};
+                cells.push_back(c);
+                for (int ny = std::max(cy - 2, 1); ny <= std::min(cy + 2, n); ny++) {
+                    for (int nx = std::max(cx - 2, 1); nx <= std::min(cx + 2, n); nx++) {
+                        int k = ny * stride + nx;
+                        if (world[k] == 1 && w.visited[k] != w.stamp) {
+                            w.visited[k] = w.stamp;
+                            w.queue[tail++] = k;
+                        }
+                    }
+                }
+            }
+
+            classify(w, cells, edgeOnly ? edgePeriod : maxPeriod, code, info);
+            if (edgeOnly && info.kind != Spaceship) continue;
+
+            auto it = w.census.insert(std::make_pair(code, info)).first;
+            it->second.count++;
+
+            if (edgeOnly) {
+                for (const cell &c : cells) {
+                    ca.setValue(c.x, c.y, 0);
+                }
+            }
+        }
+    }
+}
+
+
+bool SoupCensus::runSoup(workerState &w, int soup) {
+    /* one soup from random start to census, true if it settled */
+
+    CAbase &ca = w.board;
+    ca.clearWorld();
+    ca.setSeed(baseSeed + unsigned(soup));
+    int corner = (universeSize - soupSize) / 2 + 1;
+    ca.putRandomSoup(corner, corner, soupSize, soupSize, density);
+
+    bool settled = false;
+    w.populations.clear();
+    for (int g = 1; g <= maxGenerations && !settled; g++) {
+        ca.worldEvolutionLife();
+        w.generations++;
+        if (ca.isNotChanged()) {
+            settled = true;
+            break;
+        }
+        w.populations.push_back(ca.countLife());
+
+        if (g % checkInterval == 0) {
+            collectObjects(w, true);
+            settled = isPeriodic(w.populations, maxPeriod);
+        }
+    }
+
+    collectObjects(w, false);
+    return settled;
+}
+
+
+void SoupCensus::run(int soups) {
+    /* run all soups and merge the per-worker censuses */
+
+    WorkStealingPool pool(threads);
+    int workers = pool.getThreadCount();
+
+    std::vector<std::unique_ptr<workerState> > state;
+    for (int i = 0; i < workers; i++) {
+        state.push_back(std::unique_ptr<workerState>(new workerState(universeSize)));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    pool.run(soups, [&](int soup, int worker) {
+        workerState &w = *state[worker];
+        if (runSoup(w, soup)) w.settled++;
+        w.soups++;
+    });
+
+    total.seconds = timer.nsecsElapsed() / 1e9;
+    total.threads = workers;
+    total.soups = total.settled = total.generations = 0;
+    census.clear();
+    for (int i = 0; i < workers; i++) {
+        const workerState &w = *state[i];
+        total.soups += w.soups;
+        total.settled += w.settled;
+        total.generations += w.generations;
+        for (auto &entry : w.census) {
+            auto it = census.insert(entry);
+            if (!it.second) it.first->second.count += entry.second.count;
+        }
+    }
+}
+
+
+bool SoupCensus::writeCsv(const QString &filename) const {
+    /* one line per object, most frequent first */
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    std::vector<std::pair<std::string, object> > rows(census.begin(), census.end());
+    std::stable_sort(rows.begin(), rows.end(), [](const std::pair<std::string, object> &a,
+                                                  const std::pair<std::string, object> &b) {
+        return a.second.count > b.second.count;
+    });
+
+    const char *kinds[] = {"still life", "oscillator", "spaceship", "unidentified"};
+    QTextStream out(&file);
+    out << "object,kind,period,population,count,per_soup\n";
+    for (const std::pair<std::string, object> &row : rows) {
+        out << QString::fromStdString(row.first) << "," << kinds[row.second.kind] << ","
+            << row.second.period << "," << row.second.population << "," << row.second.count << ","
+            << (total.soups ? double(row.second.count) / total.soups : 0.0) << "\n";
+    }
+    out.flush();
+    file.close();
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef SOUPCENSUS_H
+#define SOUPCENSUS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <QString>
+
+class CAbase;
+class CAsparse;
+
+class SoupCensus {
+    /* run random Game of Life soups until they settle and count the objects left over
+     *
+     * Every soup is a soupSize x soupSize random square in the middle of a torus board. It
+     * runs until its population is periodic (or maxGenerations is reached); spaceships that
+     * come close to the edge of the board are counted and removed before they wrap around.
+     * The remaining cells are split into objects (cells at most two apart) and every object
+     * is run alone on an unbounded plane to find its period and motion. Objects are named by
+     * their canonical form: the smallest encoding over all phases and the eight symmetries.
+     * Soups are scheduled on a work-stealing pool, every worker keeps its own boards and
+     * census, which are merged when all soups are done.
+     */
+
+public:
+    SoupCensus(int universeSize, int soupSize, double density);
+
+    void setThreads(int n) {
+        threads = n;
+    }
+
+    void setBaseSeed(unsigned int s) {
+        baseSeed = s;
+    }
+
+    void setMaxGenerations(int n) {
+        maxGenerations = n;
+    }
+
+    void run(int soups);
+
+    bool writeCsv(const QString &filename) const;
+
+    enum Kind {
+        StillLife,
+        Oscillator,
+        Spaceship,
+        Unidentified
+    };
+
+    struct object {
+        int kind;
+        int period;
+        int population;
+        long long count;
+    };
+
+    struct results {
+        long long soups;
+        long long settled;     // soups whose population became periodic in time
+        long long generations; // generations run in all soups
+        double seconds;
+        int threads;
+    };
+
+    const results &getResults() const {
+        return total;
+    }
+
+    const std::map<std::string, object> &getCensus() const {
+        return census;
+    }
+
+    static const int maxPeriod = 30;     // longest period looked for
+    static const int maxObjectSize = 40; // larger objects are not identified
+
+    struct cell {
+        int x;
+        int y;
+    };
+
+private:
+    struct workerState;
+
+    bool runSoup(workerState &w, int soup);
+
+    void collectObjects(workerState &w, bool edgeOnly);
+
+    void classify(workerState &w, const std::vector<cell> &cells, int periodLimit, std::string &code, object &info);
+
+    static std::string canonicalCode(const std::vector<cell> &cells);
+
+    int universeSize;
+    int soupSize;
+    double density;
+    int threads;
+    unsigned int baseSeed;
+    int maxGenerations;
+    results total;
+    std::map<std::string, object> census;
+};
+
+#endif // SOUPCENSUS_H
@@ -0,0 +1,391 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+
+#include "stripcluster.h"
+
+
+static const quint32 regionMagic = 0x43415331; // "CAS1"
+static const int waitSliceMs = 1000;           // how often a waiting coordinator looks for dead workers
+
+enum {
+    Load,  // copy the strip out of the frame
+    Store, // copy the strip into the frame
+    Step,  // run steps generations
+    Quit
+};
+
+
+struct StripCluster::controlBlock {
+    quint32 magic;
+    int nx;
+    int ny;
+    int strips;
+    int command;
+    int steps;
+    int changed[maxStrips];
+    sem_t start[maxStrips];   // coordinator -> worker: command is ready
+    sem_t done;               // worker -> coordinator: attached or command done
+    pthread_barrier_t barrier; // between the workers, once per generation
+};
+
+
+struct regionLayout {
+    /* byte offsets of the parts of the shared region */
+
+    size_t borders; // 2 sets x strips x (first row, last row) x nx cells
+    size_t frame;   // ny x nx cells, the interior of the board without halo
+    size_t total;
+
+    regionLayout(size_t control, int nx, int ny, int strips) {
+        borders = (control + 63) & ~size_t(63);
+        frame = borders + size_t(2) * strips * 2 * nx * sizeof(int);
+        total = frame + size_t(nx) * ny * sizeof(int);
+    }
+};
+
+
+static int stripBegin(int strip, int ny, int strips) {
+    // first row of a strip (1..ny)
+    return int(qint64(strip) * ny / strips) + 1;
+}
+
+
+static bool waitSemaphore(sem_t *s, int timeoutMs) {
+    /* sem_wait with a timeout (timeoutMs < 0: forever), false on timeout */
+
+    if (timeoutMs < 0) {
+        while (sem_wait(s) != 0) {
+            if (errno != EINTR) return false;
+        }
+        return true;
+    }
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeoutMs / 1000;
+    until.tv_nsec += long(timeoutMs % 1000) * 1000000;
+    if (until.tv_nsec >= 1000000000) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+    }
+    while (sem_timedwait(s, &until) != 0) {
+        if (errno != EINTR) return false;
+    }
+    return true;
+}
+
+
+StripCluster::StripCluster(int nx, int ny, int strips) :
+    nx(nx),
+    ny(ny),
+    strips(strips),
+    control(0),
+    frame(0),
+    mappedBytes(0),
+    unchanged(false)
+{
+}
+
+
+StripCluster::~StripCluster() {
+    stop();
+}
+
+
+bool StripCluster::start() {
+    /* create and map the shared region, start one worker process per strip and wait until all are attached */
+
+    if (control) return true;
+    if (strips < 1 || strips > maxStrips || strips > ny || nx < 3) {
+        error = QString("cannot split %1 x %2 cells into %3 strips").arg(nx).arg(ny).arg(strips);
+        return false;
+    }
+
+    static int regions = 0;
+    name = QString("/ca-strips-%1-%2").arg(getpid()).arg(++regions);
+    QByteArray path = name.toLocal8Bit();
+
+    int fd = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        error = "shm_open failed for " + name;
+        return false;
+    }
+    regionLayout layout(sizeof(controlBlock), nx, ny, strips);
+    void *region = MAP_FAILED;
+    if (ftruncate(fd, off_t(layout.total)) == 0) {
+        region = mmap(0, layout.total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (region == MAP_FAILED) {
+        shm_unlink(path.constData());
+        error = QString("cannot map %1 bytes of shared memory").arg(layout.total);
+        return false;
+    }
+
+    mappedBytes = layout.total;
+    control = static_cast<controlBlock*>(region);
+    frame = reinterpret_cast<int*>(static_cast<char*>(region) + layout.frame);
+    control->magic = regionMagic;
+    control->nx = nx;
+    control->ny = ny;
+    control->strips = strips;
+    control->command = Load;
+    control->steps = 0;
+    for (int s = 0; s < strips; s++) {
+        control->changed[s] = 0;
+        sem_init(&control->start[s], 1, 0);
+    }
+    sem_init(&control->done, 1, 0);
+    pthread_barrierattr_t attributes;
+    pthread_barrierattr_init(&attributes);
+    pthread_barrierattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&control->barrier, &attributes, unsigned(strips));
+    pthread_barrierattr_destroy(&attributes);
+
+    for (int s = 0; s < strips; s++) {
+        QProcess *worker = new QProcess;
+        worker->setProcessChannelMode(QProcess::ForwardedChannels);
+        worker->start(QCoreApplication::applicationFilePath(),
+                      QStringList() << "--strip-worker" << name << "--strip" << QString::number(s));
+        workers.push_back(worker);
+        if (!worker->waitForStarted()) {
+            error = QString("strip worker %1 did not start").arg(s);
+            shutdown(false);
+            return false;
+        }
+    }
+
+    // every worker has mapped the region once it reports back, so its name is not needed any more
+    bool attached = waitForWorkers();
+    shm_unlink(path.constData());
+    if (!attached) {
+        shutdown(false);
+        return false;
+    }
+    return true;
+}
+
+
+void StripCluster::stop() {
+    shutdown(true);
+}
+
+
+void StripCluster::shutdown(bool graceful) {
+    /* ask the workers to quit (or kill them), then release the region */
+
+    if (graceful && control && !workers.empty()) {
+        control->command = Quit;
+        for (int s = 0; s < strips; s++) {
+            sem_post(&control->start[s]);
+        }
+    }
+    for (QProcess *worker : workers) {
+        if (!graceful || !worker->waitForFinished(waitSliceMs)) {
+            worker->kill();
+            worker->waitForFinished(waitSliceMs);
+        }
+        delete worker;
+    }
+    workers.clear();
+
+    if (control) {
+        for (int s = 0; s < strips; s++) {
+            sem_destroy(&control->start[s]);
+        }
+        sem_destroy(&control->done);
+        pthread_barrier_destroy(&control->barrier);
+        munmap(control, mappedBytes);
+        control = 0;
+        frame = 0;
+        mappedBytes = 0;
+    }
+}
+
+
+bool StripCluster::waitForWorkers() {
+    /* collect one acknowledgement per worker, giving up when a worker has died */
+
+    for (int s = 0; s < strips; s++) {
+        while (!waitSemaphore(&control->done, waitSliceMs)) {
+            for (size_t w = 0; w < workers.size(); w++) {
+                if (workers[w]->state() == QProcess::NotRunning || workers[w]->waitForFinished(0)) {
+                    error = QString("strip worker %1 exited").arg(w);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+bool StripCluster::command(int c, int steps) {
+    /* run one command on all workers and wait until every one has finished it */
+
+    if (!control) {
+        error = "strip workers are not running";
+        return false;
+    }
+
+    control->command = c;
+    control->steps = steps;
+    for (int s = 0; s < strips; s++) {
+        sem_post(&control->start[s]);
+    }
+    if (!waitForWorkers()) {
+        // the others may be stuck at the barrier now
+        shutdown(false);
+        return false;
+    }
+    return true;
+}
+
+
+bool StripCluster::load(const CAview &view) {
+    if (view.nx != nx || view.ny != ny) {
+        error = "the board does not have the size of the strips";
+        return false;
+    }
+    if (!control) {
+        error = "strip workers are not running";
+        return false;
+    }
+
+    for (int y = 1; y <= ny; y++) {
+        memcpy(frame + size_t(y - 1) * nx, view.world + y * (nx + 2) + 1, nx * sizeof(int));
+    }
+    unchanged = false;
+    return command(Load);
+}
+
+
+bool StripCluster::step(int generations) {
+    CA_TRACE_SCOPE("StripCluster", "step");
+
+    if (generations <= 0) return true;
+    if (!command(Step, generations)) return false;
+
+    unchanged = true;
+    for (int s = 0; s < strips; s++) {
+        if (control->changed[s]) unchanged = false;
+    }
+    return true;
+}
+
+
+bool StripCluster::gather(CAbase &ca) {
+    /* the only place where the whole board crosses the region: only called when a frame is due */
+
+    CA_TRACE_SCOPE("StripCluster", "gather");
+
+    if (!command(Store)) return false;
+
+    if (ca.getNx() != nx || ca.getNy() != ny) {
+        ca.resetWorldSize(nx, ny);
+    }
+    for (int y = 1; y <= ny; y++) {
+        ca.setRow(y, frame + size_t(y - 1) * nx);
+    }
+    return true;
+}
+
+
+int StripCluster::runWorker(const QString &name, int strip) {
+    /* worker process: map the region, then run the commands of the coordinator on one strip */
+
+#ifdef __linux__
+    // do not outlive a coordinator that crashed
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+
+    QByteArray path = name.toLocal8Bit();
+    int fd = shm_open(path.constData(), O_RDWR, 0);
+    if (fd < 0) return 1;
+    struct stat info;
+    void *region = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(controlBlock)) {
+        region = mmap(0, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (region == MAP_FAILED) return 1;
+
+    controlBlock *c = static_cast<controlBlock*>(region);
+    if (c->magic != regionMagic || strip < 0 || strip >= c->strips) {
+        munmap(region, size_t(info.st_size));
+        return 1;
+    }
+
+    const int nx = c->nx;
+    const int ny = c->ny;
+    const int strips = c->strips;
+    regionLayout layout(sizeof(controlBlock), nx, ny, strips);
+    int *borders = reinterpret_cast<int*>(static_cast<char*>(region) + layout.borders);
+    int *frame = reinterpret_cast<int*>(static_cast<char*>(region) + layout.frame);
+
+    const int first = stripBegin(strip, ny, strips);
+    const int rows = stripBegin(strip + 1, ny, strips) - first;
+    const int above = (strip + strips - 1) % strips;
+    const int below = (strip + 1) % strips;
+    CAbase board(nx, rows);
+
+    // border row k (0: first, 1: last) of strip s in set p
+    auto border = [borders, nx, strips](int p, int s, int k) {
+        return borders + (size_t(p * strips + s) * 2 + k) * nx;
+    };
+
+    sem_post(&c->done);
+    for (;;) {
+        waitSemaphore(&c->start[strip], -1);
+        int command = c->command;
+        if (command == Quit) break;
+
+        switch (command) {
+        case Load:
+            for (int y = 1; y <= rows; y++) {
+                board.setRow(y, frame + size_t(first + y - 2) * nx);
+            }
+            break;
+
+        case Store:
+            for (int y = 1; y <= rows; y++) {
+                memcpy(frame + size_t(first + y - 2) * nx, board.getWorld() + y * (nx + 2) + 1, nx * sizeof(int));
+            }
+            break;
+
+        case Step:
+            for (int g = 0; g < c->steps; g++) {
+                // publish the own border rows, then fetch the neighbours' into the halo
+                int p = g & 1;
+                memcpy(border(p, strip, 0), board.getWorld() + (nx + 2) + 1, nx * sizeof(int));
+                memcpy(border(p, strip, 1), board.getWorld() + rows * (nx + 2) + 1, nx * sizeof(int));
+                pthread_barrier_wait(&c->barrier);
+                board.setRow(0, border(p, above, 1));
+                board.setRow(rows + 1, border(p, below, 0));
+                board.worldEvolutionLifeStrip();
+            }
+            c->changed[strip] = !board.isNotChanged();
+            break;
+
+        default:
+            break;
+        }
+        sem_post(&c->done);
+    }
+
+    munmap(region, size_t(info.st_size));
+    return 0;
+}
@@ -0,0 +1,84 @@
+#ifndef STRIPCLUSTER_H
+#define STRIPCLUSTER_H
+
+#include <vector>
+#include <QString>
+#include "CAbase.h"
+
+class QProcess;
+
+class StripCluster {
+    /* Game of Life on a torus split into horizontal strips, one worker process per strip
+     *
+     * The coordinator creates a POSIX shared-memory region holding the control block, two
+     * sets of border rows and the frame (the whole interior of the board). Every worker is
+     * this program started with --strip-worker; it keeps its strip in a CAbase whose halo
+     * rows are the ghost rows. Each generation a worker publishes its first and last row,
+     * waits on a process-shared barrier and copies the neighbouring strips' rows into its
+     * halo before stepping. The border rows alternate between the two sets, so one barrier
+     * per generation is enough. Commands are handed out with one semaphore per worker and
+     * acknowledged on a shared one. The frame is only written on request (gather).
+     */
+
+public:
+    StripCluster(int nx, int ny, int strips);
+    ~StripCluster();
+
+    int getStrips() const {
+        return strips;
+    }
+
+    const QString &errorString() const {
+        return error;
+    }
+
+    bool isRunning() const {
+        return control != 0;
+    }
+
+    // create the shared region and start the workers
+    bool start();
+
+    void stop();
+
+    // hand the interior of a board of the same size to the workers
+    bool load(const CAview &view);
+
+    // run n generations on the workers
+    bool step(int generations = 1);
+
+    // collect the current board from the workers into ca (resized if needed)
+    bool gather(CAbase &ca);
+
+    // no strip changed in the last generation of the last step
+    bool isNotChanged() const {
+        return unchanged;
+    }
+
+    static const int maxStrips = 64;
+
+    // entry point of a worker process: attach to the region and run one strip until told to quit
+    static int runWorker(const QString &name, int strip);
+
+private:
+    struct controlBlock;
+
+    bool command(int c, int steps = 0);
+
+    bool waitForWorkers();
+
+    void shutdown(bool graceful);
+
+    int nx;
+    int ny;
+    int strips;
+    QString name;
+    QString error;
+    controlBlock *control;
+    int *frame;
+    size_t mappedBytes;
+    bool unchanged;
+    std::vector<QProcess*> workers;
+};
+
+#endif // STRIPCLUSTER_H
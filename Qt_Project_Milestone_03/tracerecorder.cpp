@@ -0,0 +1,160 @@
+#include <QFile>
+#include <QTextStream>
+#include <QCoreApplication>
+
+#include "tracerecorder.h"
+
+
+TraceRecorder &TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+
+TraceRecorder::TraceRecorder() :
+    enabled(false),
+    clearedAt(0),
+    epoch(0)
+{
+    clock.start();
+}
+
+
+TraceRecorder::threadBuffer *TraceRecorder::localBuffer() {
+    /* buffer of the calling thread, registered on first use and kept until the process ends */
+
+    thread_local threadBuffer *buffer = 0;
+    if (!buffer) {
+        buffer = new threadBuffer;
+        buffer->first = buffer->last = new chunk;
+        buffer->first->count.store(0);
+        buffer->first->next.store(0);
+        buffer->chunks = 1;
+        buffer->epoch = epoch.load(std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> guard(registry);
+        buffer->tid = int(buffers.size()) + 1;
+        buffers.push_back(buffer);
+    }
+    return buffer;
+}
+
+
+void TraceRecorder::rewind(threadBuffer *buffer, int current) {
+    /* empty the chain of the calling thread after a clear(); the chunks stay for reuse
+     *
+     * Takes the registry lock so that a dump never reads a chunk while it is emptied;
+     * this only happens once per clear() and thread.
+     */
+
+    std::lock_guard<std::mutex> guard(registry);
+    for (chunk *c = buffer->first; c; c = c->next.load(std::memory_order_relaxed)) {
+        c->count.store(0, std::memory_order_relaxed);
+    }
+    buffer->last = buffer->first;
+    buffer->epoch = current;
+    buffer->dropped.store(0, std::memory_order_relaxed);
+}
+
+
+void TraceRecorder::append(const event &e) {
+    /* write the event, then publish it by bumping the count (release) */
+
+    threadBuffer *buffer = localBuffer();
+    int current = epoch.load(std::memory_order_relaxed);
+    if (buffer->epoch != current) rewind(buffer, current);
+
+    chunk *c = buffer->last;
+    int n = c->count.load(std::memory_order_relaxed);
+
+    if (n == chunkSize) {
+        chunk *next = c->next.load(std::memory_order_relaxed);
+        if (!next) {
+            if (buffer->chunks == maxChunks) {
+                buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            next = new chunk;
+            next->count.store(0, std::memory_order_relaxed);
+            next->next.store(0, std::memory_order_relaxed);
+            c->next.store(next, std::memory_order_release);
+            buffer->chunks++;
+        }
+        buffer->last = c = next;
+        n = 0;
+    }
+
+    c->events[n] = e;
+    c->count.store(n + 1, std::memory_order_release);
+}
+
+
+void TraceRecorder::complete(const char *category, const char *name, qint64 start, qint64 end) {
+    event e = {category, name, 0, 0, start, end - start, 'X'};
+    append(e);
+}
+
+
+void TraceRecorder::instant(const char *category, const char *name, const char *argName, qint64 argValue) {
+    event e = {category, name, argName, argValue, now(), 0, 'i'};
+    append(e);
+}
+
+
+bool TraceRecorder::dump(const QString &filename) const {
+    /* write all published events as Chrome Trace Event JSON (timestamps in microseconds) */
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    const qint64 pid = QCoreApplication::applicationPid();
+    const qint64 from = clearedAt.load(std::memory_order_relaxed);
+    bool first = true;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    std::lock_guard<std::mutex> guard(registry);
+    for (size_t b = 0; b < buffers.size(); b++) {
+        const threadBuffer *buffer = buffers[b];
+        out << (first ? "\n" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+        first = false;
+
+        // events lost because the chain of the thread was full (since the last clear)
+        qint64 dropped = buffer->dropped.load(std::memory_order_relaxed);
+        if (dropped > 0 && buffer->epoch == epoch.load(std::memory_order_relaxed)) {
+            out << ",\n{\"name\":\"dropped events\",\"ph\":\"C\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                << ",\"ts\":" << QString::number(now() / 1000.0, 'f', 3) << ",\"args\":{\"dropped\":" << dropped << "}}";
+        }
+
+        for (const chunk *c = buffer->first; c; c = c->next.load(std::memory_order_acquire)) {
+            int n = c->count.load(std::memory_order_acquire);
+            for (int i = 0; i < n; i++) {
+                const event &e = c->events[i];
+                if (e.start < from) continue;
+
+                out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+                    << "\",\"ph\":\"" << e.phase << "\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                    << ",\"ts\":" << QString::number(e.start / 1000.0, 'f', 3);
+                if (e.phase == 'X') {
+                    out << ",\"dur\":" << QString::number(e.duration / 1000.0, 'f', 3);
+                } else {
+                    out << ",\"s\":\"t\"";
+                }
+                if (e.argName) {
+                    out << ",\"args\":{\"" << e.argName << "\":" << e.argValue << "}";
+                }
+                out << "}";
+            }
+        }
+    }
+
+    out << "\n]}\n";
+    out.flush();
+    file.close();
+    return true;
+}
@@ -0,0 +1,135 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <QtGlobal>
+#include <QString>
+#include <QElapsedTimer>
+
+class TraceRecorder {
+    /* timeline of simulation and render events, exported as Chrome Trace Event JSON
+     *
+     * Every thread appends to its own chain of fixed-size chunks; the only shared write
+     * is publishing the new event count, so recording never takes a lock. A dump reads
+     * the published events of all threads and can be loaded into Perfetto or
+     * about:tracing. Names and categories must be string literals without quotes.
+     *
+     * clear() starts a new epoch: every thread rewinds its chain the next time it records
+     * and reuses the chunks it has. Events beyond maxChunks are counted as dropped and the
+     * count appears in the dump.
+     */
+
+public:
+    static TraceRecorder &instance();
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool on) {
+        enabled.store(on, std::memory_order_relaxed);
+    }
+
+    qint64 now() const {
+        return clock.nsecsElapsed();
+    }
+
+    // an event from start to end (ns, see now())
+    void complete(const char *category, const char *name, qint64 start, qint64 end);
+
+    // a point in time with one optional numeric argument
+    void instant(const char *category, const char *name, const char *argName = 0, qint64 argValue = 0);
+
+    // drop everything recorded so far from later dumps and let the threads reuse their chunks
+    void clear() {
+        clearedAt.store(now(), std::memory_order_relaxed);
+        epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool dump(const QString &filename) const;
+
+private:
+    TraceRecorder();
+
+    struct event {
+        const char *category;
+        const char *name;
+        const char *argName;
+        qint64 argValue;
+        qint64 start;
+        qint64 duration;
+        char phase;
+    };
+
+    static const int chunkSize = 16384;
+    static const int maxChunks = 256; // per thread, further events are dropped until clear()
+
+    struct chunk {
+        event events[chunkSize];
+        std::atomic<int> count;
+        std::atomic<chunk*> next;
+    };
+
+    struct threadBuffer {
+        int tid;
+        chunk *first;
+        chunk *last; // only touched by the owning thread
+        int chunks;
+        int epoch;   // epoch of the recorder the chain was last rewound for
+        std::atomic<qint64> dropped;
+    };
+
+    threadBuffer *localBuffer();
+
+    void rewind(threadBuffer *buffer, int current);
+
+    void append(const event &e);
+
+    std::atomic<bool> enabled;
+    std::atomic<qint64> clearedAt;
+    std::atomic<int> epoch;
+    QElapsedTimer clock;
+    mutable std::mutex registry; // guards buffers, taken once per thread and on dump
+    std::vector<threadBuffer*> buffers;
+};
+
+
+class TraceScope {
+    /* records the enclosing block as one complete event */
+
+public:
+    TraceScope(const char *category, const char *name) :
+        category(category),
+        name(name),
+        start(TraceRecorder::instance().isEnabled() ? TraceRecorder::instance().now() : -1)
+        {}
+
+    ~TraceScope() {
+        if (start >= 0) {
+            TraceRecorder &recorder = TraceRecorder::instance();
+            recorder.complete(category, name, start, recorder.now());
+        }
+    }
+
+private:
+    const char *category;
+    const char *name;
+    qint64 start;
+};
+
+
+// compile to nothing unless CA_TRACE is defined
+#ifdef CA_TRACE
+#define CA_TRACE_CONCAT2(a, b) a##b
+#define CA_TRACE_CONCAT(a, b) CA_TRACE_CONCAT2(a, b)
+#define CA_TRACE_SCOPE(category, name) TraceScope CA_TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define CA_TRACE_INSTANT(category, name, argName, argValue) \
+    do { if (TraceRecorder::instance().isEnabled()) TraceRecorder::instance().instant(category, name, argName, argValue); } while (0)
+#else
+#define CA_TRACE_SCOPE(category, name)
+#define CA_TRACE_INSTANT(category, name, argName, argValue)
+#endif
+
+#endif // TRACERECORDER_H
@@ -0,0 +1,108 @@
+#include "workstealingpool.h"
+
+
+WorkStealingPool::WorkStealingPool(int threads) :
+    threadCount(threads),
+    current(0),
+    batch(0),
+    busy(0),
+    stopping(false)
+{
+    if (threadCount < 1) {
+        threadCount = int(std::thread::hardware_concurrency());
+        if (threadCount < 1) threadCount = 1;
+    }
+    for (int i = 0; i < threadCount; i++) {
+        queues.push_back(new queue);
+    }
+    for (int w = 0; w < threadCount; w++) {
+        workers.push_back(std::thread([this, w]() { work(w); }));
+    }
+}
+
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> guard(control);
+        stopping = true;
+    }
+    started.notify_all();
+    for (size_t w = 0; w < workers.size(); w++) {
+        workers[w].join();
+    }
+    for (size_t i = 0; i < queues.size(); i++) {
+        delete queues[i];
+    }
+}
+
+
+bool WorkStealingPool::takeTask(int worker, int &task) {
+    /* pop from the own deque, otherwise steal from the others */
+
+    queue *own = queues[worker];
+    {
+        std::lock_guard<std::mutex> guard(own->lock);
+        if (!own->tasks.empty()) {
+            task = own->tasks.back();
+            own->tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (int i = 1; i < threadCount; i++) {
+        queue *victim = queues[(worker + i) % threadCount];
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if (!victim->tasks.empty()) {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void WorkStealingPool::run(int count, const std::function<void(int, int)> &task) {
+    /* deal the tasks to the workers and wait until all of them are done */
+
+    // lower indices end up at the back, so each worker starts with its first task
+    for (int i = count - 1; i >= 0; i--) {
+        queue *q = queues[i % threadCount];
+        std::lock_guard<std::mutex> guard(q->lock);
+        q->tasks.push_back(i);
+    }
+
+    std::unique_lock<std::mutex> guard(control);
+    current = &task;
+    busy = threadCount;
+    batch++;
+    started.notify_all();
+    finished.wait(guard, [this]() { return busy == 0; });
+    current = 0;
+}
+
+
+void WorkStealingPool::work(int worker) {
+    /* worker thread: wait for a batch, run tasks until nothing is left to steal */
+
+    unsigned int done = 0;
+    for (;;) {
+        const std::function<void(int, int)> *task;
+        {
+            std::unique_lock<std::mutex> guard(control);
+            started.wait(guard, [this, done]() { return batch != done || stopping; });
+            if (stopping) return;
+            done = batch;
+            task = current;
+        }
+
+        // no task is added to a running batch, so a worker may stop once nothing is left to steal
+        int t;
+        while (takeTask(worker, t)) {
+            (*task)(t, worker);
+        }
+
+        std::lock_guard<std::mutex> guard(control);
+        if (--busy == 0) finished.notify_all();
+    }
+}
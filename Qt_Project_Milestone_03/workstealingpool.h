@@ -0,0 +1,57 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+
+class WorkStealingPool {
+    /* run a batch of independent tasks on a fixed set of worker threads
+     *
+     * Tasks are dealt round robin into one deque per worker. A worker takes its own tasks
+     * from the back and, once its deque is empty, steals from the front of the others,
+     * so uneven task costs do not leave cores idle. The workers are started once and wait
+     * between batches, so a pool kept by its user costs no thread starts per batch.
+     */
+
+public:
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int getThreadCount() const {
+        return threadCount;
+    }
+
+    // calls task(index, worker) for every index in 0..count - 1, returns when all are done
+    void run(int count, const std::function<void(int, int)> &task);
+
+private:
+    struct queue {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+
+    bool takeTask(int worker, int &task);
+
+    void work(int worker);
+
+    int threadCount;
+    std::vector<queue*> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex control;                  // guards the batch state below
+    std::condition_variable started;     // a batch was handed out or the pool is stopping
+    std::condition_variable finished;    // the last worker of a batch is done
+    const std::function<void(int, int)> *current;
+    unsigned int batch;                  // number of batches handed out so far
+    int busy;                            // workers still working on the current batch
+    bool stopping;
+};
+
+#endif // WORKSTEALINGPOOL_H